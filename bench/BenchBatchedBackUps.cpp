@@ -0,0 +1,99 @@
+/* This file has been written and/or modified by the following people:
+ *
+ * Yang You
+ * Alex Schutz
+ *
+ */
+
+// Backup throughput of BeliefTreeSearch with one backup at a time and with batched backups.
+//   g++ -std=c++17 -O2 -pthread -Iinclude bench/BenchBatchedBackUps.cpp src/BeliefTreeSearch.cpp src/MCVI.cpp src/SampledBounds.cpp src/ThreadPool.cpp src/AlphaVectorFSC.cpp src/BatchedRollout.cpp src/FscPolicyEvaluation.cpp src/FscSerialization.cpp src/MessageChannel.cpp src/PlannerCheckpoint.cpp src/PolicyPublisher.cpp src/RolloutValueCache.cpp src/TrajectoryStore.cpp src/WorkStealingScheduler.cpp -o bench_batched_backups
+//   ./bench_batched_backups [threads=4] [batch=4] [trials=16] [samples=20]
+// The problem is the tiger POMDP written as a simulator. With few samples per backup, a
+// backup alone has little work to split between threads; batching backs up beliefs of
+// several trials at once. Prints backups per second for both settings, the controller
+// size and the lower bound at b0. The speedup needs at least threads free cores.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+#include "../include/BeliefTreeSearch.h"
+#include "../include/SampledBounds.h"
+
+using namespace std;
+
+// tiger: states 0 (tiger left) and 1, actions listen, open left, open right
+class TigerSim : public SimInterface
+{
+private:
+    mt19937_64 rng;
+
+    double Uniform() { return (this->rng() >> 11) * (1.0 / 9007199254740992.0); }
+
+public:
+    TigerSim() : rng(1){};
+    tuple<int, int, double, bool> Step(int sI, int aI)
+    {
+        if (aI == 0)
+        {
+            const int oI = this->Uniform() < 0.85 ? sI : 1 - sI;
+            return make_tuple(sI, oI, -1.0, false);
+        }
+        // opening resets the problem
+        const double r = (aI == 1) == (sI == 0) ? -100.0 : 10.0;
+        return make_tuple(this->SampleStartState(), (int)(this->rng() & 1), r, false);
+    }
+    int SampleStartState() { return this->rng() & 1; }
+    int GetSizeOfObs() const { return 2; }
+    int GetSizeOfA() const { return 3; }
+    double GetDiscount() const { return 0.95; }
+    int GetNbAgent() const { return 1; }
+    SimInterface *Clone() const { return new TigerSim(); }
+    void SetSeed(unsigned long seed) { this->rng.seed(seed); }
+    bool GetRewardBounds(double &r_min, double &r_max) const
+    {
+        r_min = -100.0;
+        r_max = 10.0;
+        return true;
+    }
+};
+
+int main(int argc, char **argv)
+{
+    const int nb_threads = argc > 1 ? atoi(argv[1]) : 4;
+    const int batch = argc > 2 ? atoi(argv[2]) : 4;
+    const int nb_trials = argc > 3 ? atoi(argv[3]) : 16;
+    const int nb_sample = argc > 4 ? atoi(argv[4]) : 20;
+
+    TigerSim bound_sim;
+    SampledBounds bounds(&bound_sim, 1, 5);
+    bounds.Explore({0, 1}, 200);
+    bounds.Compute();
+
+    printf("%d threads, %d trials, %d samples per action\n", nb_threads, nb_trials, nb_sample);
+    printf("%-8s %12s %14s %8s %10s\n", "batch", "backups", "backups/s", "nodes", "lower");
+    for (int b : {1, batch})
+    {
+        TigerSim sim;
+        MCVIParameters params;
+        params.nb_sample = nb_sample;
+        params.nb_threads = nb_threads;
+        params.L = 40;
+        params.seed = 3;
+        params.nb_eval_rollouts = 100;
+        MCVI planner(&sim, params);
+        BeliefTreeParameters tree_params;
+        tree_params.nb_particles = 200;
+        tree_params.max_depth = 10;
+        tree_params.backup_batch = b;
+        BeliefTreeSearch search(&planner, &sim, &bounds, tree_params);
+
+        auto t0 = chrono::steady_clock::now();
+        search.Search(nb_trials, 0.1);
+        const double seconds = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+        printf("%-8d %12lu %14.1f %8d %10.3f\n", b, planner.GetNbBackups(), planner.GetNbBackups() / seconds,
+               planner.GetFSC().GetNodeSize(), search.GetLowerBound());
+    }
+    return 0;
+}
@@ -0,0 +1,111 @@
+/* This file has been written and/or modified by the following people:
+ *
+ * Yang You
+ * Alex Schutz
+ *
+ */
+
+// Scaling of backups over 1 to N worker processes on a .pomdp model.
+//   g++ -std=c++17 -O2 -pthread -Iinclude bench/BenchDistributedScaling.cpp src/*.cpp -o bench_distributed_scaling
+//   ./bench_distributed_scaling <model.pomdp> [max_workers=4] [backups=10] [samples=400] [L=50]
+// For every number of workers W the bench forks W workers on unix sockets in /tmp, runs
+// the same backups with a DistributedEvaluator and prints the time per backup, the
+// speedup over the planner evaluating its samples itself (W = 0) and the bytes sent and
+// received per backup. The workers run on the same machine, so the speedup needs at
+// least max_workers + 1 free cores.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+#include "../include/DistributedEvaluator.h"
+#include "../include/MCVIWorker.h"
+#include "../include/ParserPOMDPSparse.h"
+#include "../include/PomdpSimulator.h"
+
+using namespace std;
+
+static MCVIParameters MakeParams(int nb_sample, int L)
+{
+    MCVIParameters params;
+    params.nb_sample = nb_sample;
+    params.L = L;
+    params.seed = 5;
+    params.common_random_numbers = true;
+    return params;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "usage: %s <model.pomdp> [max_workers] [backups] [samples] [L]\n", argv[0]);
+        return 1;
+    }
+    const string model = argv[1];
+    const int max_workers = argc > 2 ? atoi(argv[2]) : 4;
+    const int nb_backups = argc > 3 ? atoi(argv[3]) : 10;
+    const MCVIParameters params = MakeParams(argc > 4 ? atoi(argv[4]) : 400, argc > 5 ? atoi(argv[5]) : 50);
+
+    double local_ms = 0.0;
+    printf("workers  ms/backup  speedup  sent/backup  received/backup  nodes\n");
+    for (int W = 0; W <= max_workers; W++)
+    {
+        // the children must not inherit buffered output
+        fflush(stdout);
+        vector<pid_t> pids;
+        vector<string> addresses;
+        for (int k = 0; k < W; k++)
+        {
+            addresses.push_back("unix:/tmp/bench_distributed_" + to_string(getpid()) + "_" + to_string(k) + ".sock");
+            pid_t pid = fork();
+            if (pid == 0)
+            {
+                ParsedPOMDPSparse pomdp(model);
+                PomdpSimulator sim(&pomdp, params.seed);
+                MCVIWorker worker(&sim, params);
+                _exit(worker.Serve(addresses.back()) ? 0 : 1);
+            }
+            pids.push_back(pid);
+        }
+
+        ParsedPOMDPSparse pomdp(model);
+        PomdpSimulator sim(&pomdp, params.seed);
+        MCVI planner(&sim, params);
+        DistributedEvaluator evaluator(params, sim.GetSizeOfA(), sim.GetSizeOfObs());
+        for (const string &address : addresses)
+            if (!evaluator.AddWorker(address))
+                fprintf(stderr, "could not reach worker %s\n", address.c_str());
+        if (W > 0)
+            planner.SetEvaluator(&evaluator);
+
+        const vector<int> b0 = planner.SampleStartBelief(params.nb_particles);
+        auto t0 = chrono::steady_clock::now();
+        for (int k = 0; k < nb_backups; k++)
+        {
+            int nI = planner.BackUp(b0);
+            if (nI >= 0)
+                planner.PromoteToStart(nI);
+        }
+        const double ms =
+            chrono::duration<double, milli>(chrono::steady_clock::now() - t0).count() / max(1, nb_backups);
+        if (W == 0)
+            local_ms = ms;
+        printf("%7d  %9.2f  %7.2f  %11.0f  %15.0f  %5d\n", W, ms, local_ms / ms,
+               (double)evaluator.GetNbBytesSent() / max(1, nb_backups),
+               (double)evaluator.GetNbBytesReceived() / max(1, nb_backups), planner.GetFSC().GetNodeSize());
+
+        evaluator.Shutdown();
+        for (pid_t pid : pids)
+        {
+            int status;
+            waitpid(pid, &status, 0);
+            if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+                fprintf(stderr, "worker %d exited with status %d\n", (int)pid, status);
+        }
+    }
+    return 0;
+}
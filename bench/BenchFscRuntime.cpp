@@ -0,0 +1,70 @@
+/* This file has been written and/or modified by the following people:
+ *
+ * Yang You
+ * Alex Schutz
+ *
+ */
+
+// Step latency of the FSC runtime on a random controller.
+//   g++ -std=c++17 -O2 -Iinclude bench/BenchFscRuntime.cpp -o bench_fsc_runtime
+//   ./bench_fsc_runtime [nodes=100000] [instances=4096] [steps=200] [A=5] [O=8]
+// Prints the time per step of one instance stepped alone (dependent loads, the latency
+// of a step) and per instance step of FscInstanceArray::StepAll (throughput).
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+#include "../include/FscRuntime.h"
+
+using namespace std;
+
+int main(int argc, char **argv)
+{
+    const int N = argc > 1 ? atoi(argv[1]) : 100000;
+    const int nb_instances = argc > 2 ? atoi(argv[2]) : 4096;
+    const int nb_steps = argc > 3 ? atoi(argv[3]) : 200;
+    const int A = argc > 4 ? atoi(argv[4]) : 5;
+    const int O = argc > 5 ? atoi(argv[5]) : 8;
+
+    mt19937_64 rng(1);
+    vector<int32_t> actions(N), eta((size_t)N * A * O);
+    for (int nI = 0; nI < N; nI++)
+        actions[nI] = rng() % A;
+    for (size_t k = 0; k < eta.size(); k++)
+        eta[k] = rng() % N;
+    const FscPolicyView policy = MakeFscPolicyView(actions.data(), eta.data(), N, A, O);
+
+    // observations drawn up front, the loops only step
+    vector<int> obs((size_t)nb_steps * nb_instances);
+    for (size_t k = 0; k < obs.size(); k++)
+        obs[k] = rng() % O;
+
+    // one instance: every step depends on the previous node
+    const long long nb_single = (long long)nb_steps * nb_instances;
+    int nI = 0;
+    long long checksum = 0;
+    auto t0 = chrono::steady_clock::now();
+    for (long long k = 0; k < nb_single; k++)
+    {
+        nI = policy.Step(nI, obs[k]);
+        checksum += nI;
+    }
+    double single = chrono::duration<double, nano>(chrono::steady_clock::now() - t0).count() / nb_single;
+
+    FscInstanceArray instances(policy, nb_instances);
+    t0 = chrono::steady_clock::now();
+    for (int t = 0; t < nb_steps; t++)
+        instances.StepAll(&obs[(size_t)t * nb_instances]);
+    double batched =
+        chrono::duration<double, nano>(chrono::steady_clock::now() - t0).count() / ((double)nb_steps * nb_instances);
+    for (int i = 0; i < nb_instances; i++)
+        checksum += instances.GetCurrentNode(i);
+
+    printf("nodes %d, A %d, O %d, controller %.1f MB\n", N, A, O, (eta.size() + actions.size()) * 4.0 / (1 << 20));
+    printf("single instance: %.2f ns/step\n", single);
+    printf("StepAll over %d instances: %.2f ns/instance step\n", nb_instances, batched);
+    printf("(checksum %lld)\n", checksum);
+    return 0;
+}
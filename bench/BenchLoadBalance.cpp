@@ -0,0 +1,91 @@
+/* This file has been written and/or modified by the following people:
+ *
+ * Yang You
+ * Alex Schutz
+ *
+ */
+
+// Load balance of backups with a static partition of the sample tasks and with work stealing.
+//   g++ -std=c++17 -O2 -pthread -Iinclude bench/BenchLoadBalance.cpp src/MCVI.cpp src/AlphaVectorFSC.cpp src/BatchedRollout.cpp src/FscPolicyEvaluation.cpp src/FscSerialization.cpp src/MessageChannel.cpp src/PlannerCheckpoint.cpp src/PolicyPublisher.cpp src/RolloutValueCache.cpp src/TrajectoryStore.cpp src/WorkStealingScheduler.cpp -o bench_load_balance
+//   ./bench_load_balance [threads=4] [backups=20] [samples=400] [long_fraction=0.1]
+// Rollouts from most start states end on a terminal state after a few steps, those from a
+// long_fraction of them run the full horizon, so sample tasks differ a lot in cost. Every
+// simulator step burns a fixed amount of work. Prints, for both modes, the mean load
+// imbalance (busiest worker time over mean worker time), the steals and the time per
+// backup. Worker times are wall times, so the numbers need at least threads free cores.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+#include "../include/MCVI.h"
+
+using namespace std;
+
+// states below nb_long never end, the others end with probability 1/2 per step
+class TerminalSim : public SimInterface
+{
+private:
+    int nb_states;
+    int nb_long;
+    mt19937_64 rng;
+
+public:
+    TerminalSim(int nb_states, int nb_long) : nb_states(nb_states), nb_long(nb_long), rng(1){};
+    tuple<int, int, double, bool> Step(int sI, int aI)
+    {
+        // fixed cost per step, standing in for a real simulator
+        volatile double x = sI;
+        for (int k = 0; k < 200; k++)
+            x = x * 1.0000001 + 1.0;
+        const bool done = sI >= this->nb_long && (this->rng() & 1);
+        const int oI = (int)(this->rng() % 2);
+        return make_tuple(sI, oI, aI == (sI & 1) ? 1.0 : 0.0, done);
+    }
+    int SampleStartState() { return this->rng() % this->nb_states; }
+    int GetSizeOfObs() const { return 2; }
+    int GetSizeOfA() const { return 2; }
+    double GetDiscount() const { return 0.95; }
+    int GetNbAgent() const { return 1; }
+    SimInterface *Clone() const { return new TerminalSim(this->nb_states, this->nb_long); }
+    void SetSeed(unsigned long seed) { this->rng.seed(seed); }
+};
+
+int main(int argc, char **argv)
+{
+    const int nb_threads = argc > 1 ? atoi(argv[1]) : 4;
+    const int nb_backups = argc > 2 ? atoi(argv[2]) : 20;
+    const int nb_sample = argc > 3 ? atoi(argv[3]) : 400;
+    const double long_fraction = argc > 4 ? atof(argv[4]) : 0.1;
+    const int nb_states = 1000;
+
+    printf("%d threads, %d backups of %d samples per action, %.0f%% long rollouts\n", nb_threads, nb_backups,
+           nb_sample, 100.0 * long_fraction);
+    printf("%-10s %16s %10s %16s\n", "mode", "load imbalance", "steals", "ms per backup");
+    for (int stealing = 0; stealing <= 1; stealing++)
+    {
+        TerminalSim sim(nb_states, (int)(long_fraction * nb_states));
+        MCVIParameters params;
+        params.nb_sample = nb_sample;
+        params.nb_threads = nb_threads;
+        params.work_stealing = stealing;
+        params.seed = 3;
+        MCVI planner(&sim, params);
+        const vector<int> b0 = planner.SampleStartBelief(params.nb_particles);
+
+        double imbalance = 0.0;
+        unsigned long nb_steals = 0;
+        auto t0 = chrono::steady_clock::now();
+        for (int k = 0; k < nb_backups; k++)
+        {
+            planner.PromoteToStart(planner.BackUp(b0));
+            imbalance += planner.GetLastBackUpStats().load_imbalance;
+            nb_steals += planner.GetLastBackUpStats().nb_steals;
+        }
+        const double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - t0).count();
+        printf("%-10s %16.3f %10lu %16.2f\n", stealing ? "stealing" : "static", imbalance / nb_backups, nb_steals,
+               ms / nb_backups);
+    }
+    return 0;
+}
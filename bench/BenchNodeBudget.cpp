@@ -0,0 +1,86 @@
+/* This file has been written and/or modified by the following people:
+ *
+ * Yang You
+ * Alex Schutz
+ *
+ */
+
+// Policy quality against the node budget max_node_size on a .pomdp model.
+//   g++ -std=c++17 -O2 -pthread -Iinclude bench/BenchNodeBudget.cpp src/*.cpp -o bench_node_budget
+//   ./bench_node_budget <model.pomdp> [trials=100] [samples=50] [L=30] [budgets=0,2,4,8,16,32]
+// For every budget (0 is unbounded) and both replacement policies, a new planner is
+// driven by BeliefTreeSearch for the same number of trials, then the controller is
+// evaluated exactly at the initial belief. Prints the nodes kept, the exact value of the
+// start node, the lower bound the planner evaluated and the planning time.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "../include/BeliefTreeSearch.h"
+#include "../include/FscPolicyEvaluation.h"
+#include "../include/ParserPOMDPSparse.h"
+#include "../include/PomdpBounds.h"
+#include "../include/PomdpSimulator.h"
+
+using namespace std;
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "usage: %s <model.pomdp> [trials] [samples] [L] [budgets]\n", argv[0]);
+        return 1;
+    }
+    const int nb_trials = argc > 2 ? atoi(argv[2]) : 100;
+    vector<int> budgets;
+    stringstream list(argc > 5 ? argv[5] : "0,2,4,8,16,32");
+    string item;
+    while (getline(list, item, ','))
+        budgets.push_back(atoi(item.c_str()));
+
+    ParsedPOMDPSparse pomdp(argv[1]);
+    PomdpBounds bounds(&pomdp);
+    bounds.Compute();
+    FscPolicyEvaluator evaluator(&pomdp);
+
+    printf("budget  policy          nodes  exact V(b0)  evaluated lower  seconds\n");
+    for (int budget : budgets)
+    {
+        for (FscReplacementPolicy policy : {FscReplacementPolicy::LeastVisited, FscReplacementPolicy::LeastValuable})
+        {
+            if (budget == 0 && policy == FscReplacementPolicy::LeastValuable)
+                continue;
+            MCVIParameters params;
+            params.nb_sample = argc > 3 ? atoi(argv[3]) : 50;
+            params.L = argc > 4 ? atoi(argv[4]) : 30;
+            params.seed = 11;
+            params.max_node_size = budget;
+            params.replacement_policy = policy;
+            params.nb_eval_rollouts = 200;
+            PomdpSimulator sim(&pomdp, params.seed);
+            MCVI planner(&sim, params);
+            BeliefTreeParameters tree_params;
+            tree_params.nb_particles = 500;
+            tree_params.max_depth = 10;
+            tree_params.seed = params.seed;
+            BeliefTreeSearch search(&planner, &sim, &bounds, tree_params);
+
+            auto t0 = chrono::steady_clock::now();
+            search.Search(nb_trials, 0.0);
+            const double seconds = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+
+            const AlphaVectorFSC &fsc = planner.GetFSC();
+            evaluator.Reset();
+            evaluator.Evaluate(fsc, 1e-6);
+            printf("%6d  %-14s  %5d  %11.4f  %15.4f  %7.2f\n", budget,
+                   policy == FscReplacementPolicy::LeastVisited ? "least visited" : "least valuable",
+                   fsc.GetNodeSize(), evaluator.GetValue(0, *pomdp.GetInitBeliefSparse()), search.GetLowerBound(),
+                   seconds);
+            fflush(stdout);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,182 @@
+/* This file has been written and/or modified by the following people:
+ *
+ * Yang You
+ * Alex Schutz
+ *
+ */
+
+// Execution locality before and after ReorderFSCByVisits.
+//   g++ -std=c++17 -O2 -Iinclude bench/BenchNodeReordering.cpp src/FscNodeReordering.cpp src/AlphaVectorFSC.cpp
+//       -o bench_node_reordering
+//   ./bench_node_reordering [nodes=200000] [O=4] [instances=4096] [steps=500]
+// The controller is a tree in breadth-first order (edge o of node k goes to k * O + o + 1,
+// wrapping at the end) whose node indices are then shuffled, as a planner adding nodes
+// in backup order leaves them. Observations are skewed, P(o) = 2^-(o+1), so a few paths
+// carry most steps. Prints, before and after the reordering, the time per step of planner
+// rollouts (single trajectories from node 0 through the simulator, the loop of
+// MCVI::SimulateTrajectory, once over the AlphaVectorFSC and once over the FscPolicyTable
+// snapshot the planner rolls out through), the time per instance step of the runtime, and
+// the 4 KB pages of the eta table that hold 90% of the visits.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <tuple>
+#include <vector>
+#include "../include/AlphaVectorFSC.h"
+#include "../include/FscNodeReordering.h"
+#include "../include/FscRuntime.h"
+
+using namespace std;
+
+static int SkewedObs(mt19937_64 &rng, int O)
+{
+    int oI = 0;
+    while (oI < O - 1 && (rng() & 1))
+        oI++;
+    return oI;
+}
+
+// one state, observations drawn with SkewedObs
+class SkewedObsSim : public SimInterface
+{
+private:
+    int O;
+    mt19937_64 rng;
+
+public:
+    SkewedObsSim(int O) : O(O), rng(7){};
+    tuple<int, int, double, bool> Step(int sI, int aI)
+    {
+        (void)aI;
+        return make_tuple(sI, SkewedObs(this->rng, this->O), 0.0, false);
+    }
+    int SampleStartState() { return 0; }
+    int GetSizeOfObs() const { return this->O; }
+    int GetSizeOfA() const { return 1; }
+    double GetDiscount() const { return 0.95; }
+    int GetNbAgent() const { return 1; }
+};
+
+/* 4 KB pages of the eta table holding 90% of the profiled visits */
+static int HotPages(const AlphaVectorFSC &fsc, const FscVisitProfile &profile)
+{
+    const int N = fsc.GetNodeSize();
+    const size_t nodes_per_page = max<size_t>(1, 4096 / (sizeof(int32_t) * fsc.GetSizeOfA() * fsc.GetSizeOfObs()));
+    vector<uint64_t> page_visits(N / nodes_per_page + 1, 0);
+    uint64_t total = 0;
+    for (int nI = 0; nI < N; nI++)
+    {
+        page_visits[nI / nodes_per_page] += profile.node_visits[nI];
+        total += profile.node_visits[nI];
+    }
+    sort(page_visits.rbegin(), page_visits.rend());
+    uint64_t covered = 0;
+    int nb_pages = 0;
+    while (covered < 0.9 * total)
+        covered += page_visits[nb_pages++];
+    return nb_pages;
+}
+
+/* ns per step of nb_runs rollouts of L steps from node 0 through the controller, following
+   unset edges and nodes without action by staying, as MCVI::SimulateTrajectory does */
+template <class Controller>
+static double TimeRollouts(const Controller &fsc, SimInterface *sim, int nb_runs, int L)
+{
+    const double gamma = sim->GetDiscount();
+    double total = 0.0;
+    auto t0 = chrono::steady_clock::now();
+    for (int run = 0; run < nb_runs; run++)
+    {
+        int nI = 0;
+        int sI = sim->SampleStartState();
+        double discount = 1.0;
+        for (int step = 0; step < L; step++)
+        {
+            const int aI = fsc.GetBestAction(nI);
+            if (aI < 0)
+                break;
+            int oI;
+            double r;
+            bool done;
+            tie(sI, oI, r, done) = sim->Step(sI, aI);
+            total += discount * r;
+            discount *= gamma;
+            const int n_next = fsc.GetEtaValue(nI, aI, oI);
+            nI = n_next < 0 ? nI : n_next;
+            if (done)
+                break;
+        }
+    }
+    const double ns = chrono::duration<double, nano>(chrono::steady_clock::now() - t0).count();
+    // keep the returns alive
+    if (total < 0.0)
+        printf(" ");
+    return ns / ((double)nb_runs * L);
+}
+
+/* ns per instance step of FscInstanceArray over the controller */
+static double TimeSteps(const AlphaVectorFSC &fsc, const vector<int> &obs, int nb_instances, int nb_steps)
+{
+    FscPolicyTable table(fsc);
+    FscInstanceArray instances(table.GetView(), nb_instances);
+    auto t0 = chrono::steady_clock::now();
+    for (int t = 0; t < nb_steps; t++)
+        instances.StepAll(&obs[(size_t)t * nb_instances]);
+    return chrono::duration<double, nano>(chrono::steady_clock::now() - t0).count() / ((double)nb_steps * nb_instances);
+}
+
+int main(int argc, char **argv)
+{
+    const int N = argc > 1 ? atoi(argv[1]) : 200000;
+    const int O = argc > 2 ? atoi(argv[2]) : 4;
+    const int nb_instances = argc > 3 ? atoi(argv[3]) : 4096;
+    const int nb_steps = argc > 4 ? atoi(argv[4]) : 500;
+
+    // breadth-first tree, then shuffled indices with the root kept at 0
+    mt19937_64 rng(1);
+    vector<int> position(N);
+    for (int k = 0; k < N; k++)
+        position[k] = k;
+    shuffle(position.begin() + 1, position.end(), rng);
+    AlphaVectorFSC fsc(1, O);
+    for (int k = 0; k < N; k++)
+    {
+        FscNode node;
+        node.best_action = 0;
+        fsc.AddNode(node);
+    }
+    for (int k = 0; k < N; k++)
+        for (int oI = 0; oI < O; oI++)
+            fsc.UpdateEta(position[k], 0, oI, position[((long long)k * O + oI + 1) % N]);
+
+    vector<int> obs((size_t)nb_steps * nb_instances);
+    for (size_t k = 0; k < obs.size(); k++)
+        obs[k] = SkewedObs(rng, O);
+
+    SkewedObsSim sim(O);
+    const int nb_runs = 2000, L = nb_steps;
+    FscVisitProfile before = ProfileNodeVisits(fsc, &sim, nb_runs, L);
+    const double fsc_before = TimeRollouts(fsc, &sim, nb_runs, L);
+    const double table_before = TimeRollouts(FscPolicyTable(fsc), &sim, nb_runs, L);
+    const double t_before = TimeSteps(fsc, obs, nb_instances, nb_steps);
+    const int pages_before = HotPages(fsc, before);
+
+    ReorderFSCByVisits(fsc, &sim, nb_runs, L);
+    FscVisitProfile after = ProfileNodeVisits(fsc, &sim, nb_runs, L);
+    const double fsc_after = TimeRollouts(fsc, &sim, nb_runs, L);
+    const double table_after = TimeRollouts(FscPolicyTable(fsc), &sim, nb_runs, L);
+    const double t_after = TimeSteps(fsc, obs, nb_instances, nb_steps);
+    const int pages_after = HotPages(fsc, after);
+
+    printf("nodes %d, O %d, %d rollouts x %d steps, %d instances x %d steps\n", N, O, nb_runs, L, nb_instances,
+           nb_steps);
+    printf("                 rollouts (fsc / table)     runtime\n");
+    printf("original order:  %6.2f / %6.2f ns/step   %6.2f ns/step, 90%% of visits on %d pages\n", fsc_before,
+           table_before, t_before, pages_before);
+    printf("reordered:       %6.2f / %6.2f ns/step   %6.2f ns/step, 90%% of visits on %d pages\n", fsc_after,
+           table_after, t_after, pages_after);
+    return 0;
+}
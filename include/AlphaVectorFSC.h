@@ -2,24 +2,102 @@
  *
  * Yang You
  * Alex Schutz
- * 
+ *
  */
 
+#ifndef _ALPHAVECTORFSC_H_
+#define _ALPHAVECTORFSC_H_
+
+#include <iostream>
+#include <vector>
+
+using namespace std;
+
+// FSC node
+struct FscNode
+{
+    // particles of the node's state
+    vector<int> state_particles;
+    // Q-value of each action
+    vector<double> Q_action;
+    // immediate reward of each action
+    vector<double> R_action;
+    // value of the node
+    double V_node = 0.0;
+    // action executed in this node, -1 until the node has been backed up
+    int best_action = -1;
+    // number of times rollouts entered the node through an edge from another node; rollouts
+    // starting in it do not count, every node is the start of some while it is a candidate
+    unsigned long nb_visits = 0;
+};
+
+// which node a full controller gives up for a new one
+enum class FscReplacementPolicy
+{
+    LeastValuable,
+    LeastVisited,
+};
+
 class AlphaVectorFSC
 {
 private:
-    /* data */
+    // nodes of the controller, node 0 is the start node
+    vector<FscNode> nodes;
+    // eta as a flat (nI, aI, oI) -> nI_next table, -1 if the edge is not set
+    vector<int> eta;
+    int A_size = 0;
+    int Obs_size = 0;
+    double max_accept_belief_gap = 0.0;
+    // node budget, 0 means unbounded
+    int max_node_size = 0;
+
 public:
-    AlphaVectorFSC(/* args */);
+    AlphaVectorFSC(){};
+    AlphaVectorFSC(int A_size, int Obs_size, double max_accept_belief_gap = 0.0);
     ~AlphaVectorFSC();
-};
 
-AlphaVectorFSC::AlphaVectorFSC(/* args */)
-{
-}
+    // create a node (not yet added) holding belief b
+    FscNode CreateNode(const vector<int> &b) const;
+    // append a node without outgoing edges, returns its index
+    int AddNode(const FscNode &node);
+    int GetNodeSize() const;
+    int GetSizeOfA() const;
+    int GetSizeOfObs() const;
+    double GetMaxAcceptBeliefGap() const;
+    FscNode &GetNode(int nI);
+    const FscNode &GetNode(int nI) const;
+    int GetBestAction(int nI) const;
+    // returns the next node, or -1 if the edge (aI, oI) has not been set
+    int GetEtaValue(int nI, int aI, int oI) const;
+    void UpdateEta(int nI, int aI, int oI, int nI_next);
+    // flat eta table of size GetNodeSize() * |A| * |O|
+    const vector<int> &GetEta() const;
+    // new_index[nI] is the index of node nI after renumbering, -1 drops it; nodes sharing
+    // an index are merged into the first of them. Edges to dropped nodes become unset.
+    void Renumber(const vector<int> &new_index);
 
-AlphaVectorFSC::~AlphaVectorFSC()
-{
-}
+    // ---- bounded size ----
+    // 0 means unbounded; the start node is never replaced, so 1 is raised to 2
+    void SetMaxNodeSize(int max_node_size);
+    int GetMaxNodeSize() const;
+    bool IsFull() const;
+    // node to give up when full (never the start node 0), -1 if there is none
+    int FindReplaceableNode(FscReplacementPolicy policy) const;
+    // node that takes over the incoming edges of nI: same action and closest value if
+    // possible, otherwise the closest value
+    int FindSubstituteNode(int nI) const;
+    // overwrite nI with node and its outgoing edges (edges[aI * |O| + oI]); edges that
+    // pointed to nI, including the new ones, are redirected to its substitute, which
+    // is returned
+    int ReplaceNode(int nI, const FscNode &node, const vector<int> &edges);
+    // add node with its edges, replacing a node chosen by policy once the budget is
+    // reached; returns the index the node was stored at, -1 if the controller is full
+    // and has no node to give up
+    int AddNodeBounded(const FscNode &node, const vector<int> &edges,
+                       FscReplacementPolicy policy = FscReplacementPolicy::LeastVisited);
+};
 
+// argmax of the node's Q-values (first maximum wins), -1 if Q is empty
+int ComputeBestAction(const FscNode &n);
 
+#endif /* !_ALPHAVECTORFSC_H_ */
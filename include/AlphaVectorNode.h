@@ -1,16 +1,51 @@
+/* This file has been written and/or modified by the following people:
+ *
+ * Yang You
+ * Alex Schutz
+ *
+ */
+
+#ifndef _ALPHAVECTORNODE_H_
+#define _ALPHAVECTORNODE_H_
+
+#include <map>
+#include <vector>
+
+using namespace std;
+
+// Alpha vector of an FSC node: the node's value at every state. Values are either
+// dense, or sparse with a default value for the states that are not stored.
 class AlphaVectorNode
 {
 private:
-    /* data */
+    // controller node this vector belongs to
+    int nI = -1;
+    int S_size = 0;
+    // dense values, or the stored values when sparse
+    vector<double> values;
+    // sorted state indices of the stored values, empty when dense
+    vector<int> sparse_index;
+    double default_value = 0.0;
+    bool is_sparse = false;
+
 public:
-    AlphaVectorNode(/* args */);
+    AlphaVectorNode(){};
     ~AlphaVectorNode();
-};
+    AlphaVectorNode(int nI, const vector<double> &dense_values);
+    AlphaVectorNode(int nI, int S_size, const map<int, double> &sparse_values, double default_value);
 
-AlphaVectorNode::AlphaVectorNode(/* args */)
-{
-}
+    int GetNodeIndex() const;
+    int GetSizeOfS() const;
+    bool IsSparse() const;
+    double operator[](int sI) const;
+    // alpha . b for a dense belief, a sparse belief, and the empirical belief of particles
+    double Dot(const vector<double> &belief) const;
+    double Dot(const map<int, double> &belief) const;
+    double Dot(const vector<int> &particles) const;
+    // true if this vector is >= o at every state
+    bool Dominates(const AlphaVectorNode &o) const;
+    // write the dense values into out[0 .. |S|)
+    void CopyDense(double *out) const;
+};
 
-AlphaVectorNode::~AlphaVectorNode()
-{
-}
+#endif /* !_ALPHAVECTORNODE_H_ */
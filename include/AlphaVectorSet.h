@@ -0,0 +1,54 @@
+/* This file has been written and/or modified by the following people:
+ *
+ * Yang You
+ * Alex Schutz
+ *
+ */
+
+#ifndef _ALPHAVECTORSET_H_
+#define _ALPHAVECTORSET_H_
+
+#include <map>
+#include <vector>
+#include "AlphaVectorNode.h"
+
+using namespace std;
+
+// Alpha vectors of several FSC nodes packed into one node-major matrix, used to pick
+// the best node for an arbitrary belief. Rows are padded to a multiple of 8 doubles so
+// that the dense query runs full AVX2 / AVX-512 lanes (when compiled with -mavx2 -mfma
+// or -mavx512f) and falls back to scalar code otherwise.
+class AlphaVectorSet
+{
+private:
+    int S_size = 0;
+    int row_stride = 0;
+    vector<double> matrix;
+    // controller node of every row
+    vector<int> node_index;
+
+public:
+    AlphaVectorSet(){};
+    ~AlphaVectorSet();
+    explicit AlphaVectorSet(int S_size);
+    // rows of a node-major |N| x |S| value table, e.g. FscPolicyEvaluator::GetValues()
+    AlphaVectorSet(int nb_nodes, int S_size, const vector<double> &node_major_values);
+
+    void AddVector(const AlphaVectorNode &alpha);
+    void AddVector(int nI, const double *values);
+    int GetSize() const;
+    int GetSizeOfS() const;
+    int GetNodeIndex(int row) const;
+    const double *GetRow(int row) const;
+
+    // node maximizing alpha . b, -1 if the set is empty; value receives the maximum
+    int BestNode(const vector<double> &belief, double *value = nullptr) const;
+    int BestNode(const map<int, double> &belief, double *value = nullptr) const;
+    int BestNode(const vector<int> &particles, double *value = nullptr) const;
+
+    // remove every vector that is pointwise dominated by another one (ties keep the
+    // first), returns the number of vectors removed
+    int PruneDominated();
+};
+
+#endif /* !_ALPHAVECTORSET_H_ */
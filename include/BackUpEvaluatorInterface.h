@@ -0,0 +1,52 @@
+/* This file has been written and/or modified by the following people:
+ *
+ * Yang You
+ * Alex Schutz
+ *
+ */
+
+#ifndef _BACKUPEVALUATORINTERFACE_H_
+#define _BACKUPEVALUATORINTERFACE_H_
+
+#include <chrono>
+#include <vector>
+#include "FscRuntime.h"
+
+using namespace std;
+
+// samples [i_begin, i_end) of action aI of a backup, with rollouts of horizon steps
+struct SampleJob
+{
+    unsigned long backup_id;
+    int aI;
+    int i_begin;
+    int i_end;
+    int horizon;
+};
+
+// sums over the samples of a job: acc = [R sum | count per o | V sum per (o, n)]
+struct SampleJobResult
+{
+    vector<double> acc;
+    vector<unsigned long> visits;
+    unsigned long nb_sim_calls = 0;
+};
+
+// Evaluates the samples of a backup somewhere else than in the planner's threads.
+class BackUpEvaluatorInterface
+{
+public:
+    BackUpEvaluatorInterface(){};
+    virtual ~BackUpEvaluatorInterface(){};
+
+    // Evaluate jobs of a backup at belief against the controller snapshot, whose node
+    // versions are versions (see MCVI::GetControllerVersion), into results[j] for jobs[j].
+    // The results must be those of MCVI::EvaluateSamples with the planner's parameters.
+    // Returns false if the jobs could not be evaluated, or not before deadline
+    // (time_point::max() for none).
+    virtual bool EvaluateSamples(const FscPolicyTable &snapshot, const vector<unsigned long> &versions,
+                                 const vector<int> &belief, const vector<SampleJob> &jobs,
+                                 vector<SampleJobResult> &results, chrono::steady_clock::time_point deadline) = 0;
+};
+
+#endif /* !_BACKUPEVALUATORINTERFACE_H_ */
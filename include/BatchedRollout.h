@@ -0,0 +1,63 @@
+/* This file has been written and/or modified by the following people:
+ *
+ * Yang You
+ * Alex Schutz
+ *
+ */
+
+#ifndef _BATCHEDROLLOUT_H_
+#define _BATCHEDROLLOUT_H_
+
+#include <vector>
+#include "FscRuntime.h"
+#include "SimInterface.h"
+
+using namespace std;
+
+// Rollouts of every candidate node from the same sampled state, advanced in lockstep.
+// Trajectories are grouped by their current (node, state): a group calls the simulator
+// once per step and all its members share the outcome, i.e. they use common random
+// numbers from then on. Groups only ever merge, so each group stores its discounted
+// reward and the group it continues in, and the returns are summed backwards at the
+// end. Buffers are kept between calls; use one instance per thread.
+class BatchedRollout
+{
+private:
+    // per group: current node, current state, discounted reward, next group, members
+    vector<int> group_node;
+    vector<int> group_state;
+    vector<double> group_reward;
+    vector<int> group_next;
+    vector<int> group_size;
+    vector<int> active;
+    vector<int> next_active;
+    // open addressing table (node, state) -> group of the next step, stamped per step
+    vector<long long> table_key;
+    vector<int> table_group;
+    vector<unsigned> table_stamp;
+    unsigned stamp = 0;
+    unsigned long nb_sim_calls = 0;
+    unsigned long nb_ended = 0;
+    unsigned long nb_steps_saved = 0;
+
+    int FindOrAddGroup(int nI, int sI);
+
+public:
+    BatchedRollout(){};
+    ~BatchedRollout(){};
+
+    // V[nI] = discounted return of L steps from (nI, sI) for every nI < policy.node_size,
+    // trajectories end early when the simulator reports a terminal state;
+    // visits[nI] (optional) counts the trajectories entering node nI through an edge from
+    // another node. With step_seeds (L values) the simulator is reseeded before every call
+    // of step t, so diverged groups still see the same noise per step.
+    void Run(const FscPolicyView &policy, int sI, int L, double gamma, SimInterface *sim, double *V,
+             unsigned long *visits = nullptr, const unsigned long *step_seeds = nullptr);
+    // counters since construction: simulator calls, trajectories that ended at a terminal
+    // state or after L steps, and steps skipped by terminal states
+    unsigned long GetNbSimCalls() const;
+    unsigned long GetNbEnded() const;
+    unsigned long GetNbStepsSaved() const;
+};
+
+#endif /* !_BATCHEDROLLOUT_H_ */
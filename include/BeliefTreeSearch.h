@@ -0,0 +1,112 @@
+/* This file has been written and/or modified by the following people:
+ *
+ * Yang You
+ * Alex Schutz
+ *
+ */
+
+#ifndef _BELIEFTREESEARCH_H_
+#define _BELIEFTREESEARCH_H_
+
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "BoundInterface.h"
+#include "MCVI.h"
+#include "SimInterface.h"
+#include "WorkStealingScheduler.h"
+
+using namespace std;
+
+struct BeliefTreeParameters
+{
+    // particles stepped when a belief is expanded
+    int nb_particles = 1000;
+    int max_depth = 50;
+    // trials run at the same time, each on its own thread and simulator clone
+    int nb_concurrent_trials = 1;
+    // threads stepping the particles of an expansion when trials run one at a time
+    int nb_threads = 1;
+    unsigned long seed = 0;
+    // penalty, in value units, per trial already going through an action
+    double virtual_loss = 1.0;
+    // Trials whose backups are batched. With more than one, that many trials descend one
+    // after another, then the k-th last beliefs of their paths are backed up together by
+    // MCVI::BackUpConcurrent, for k = 1, 2, ..., on the planner's threads. This replaces
+    // nb_concurrent_trials, and results vary between runs like those of BackUpConcurrent.
+    int backup_batch = 1;
+};
+
+// a belief of the search tree, children are indexed [a * |O| + o]
+struct BeliefTreeNode
+{
+    vector<int> particles;
+    int depth = 0;
+    double upper = 0.0;
+    double lower = 0.0;
+    bool expanded = false;
+    // R(b, a), p(o | b, a) and the child beliefs, -1 for observations never sampled
+    vector<double> reward;
+    vector<double> obs_prob;
+    vector<int> child;
+    // trials currently going through this belief
+    int virtual_loss = 0;
+};
+
+// Forward exploration of the belief tree in the style of HSVI/SARSOP: a trial starts at
+// b0, takes the action with the largest upper bound and the observation with the largest
+// weighted excess gap p(o|b,a) * (U - L - epsilon / gamma^depth), and stops where that
+// gap is closed. The beliefs of the path are then backed up in MCVI in reverse order; the
+// node of each backup, evaluated on its own by MCVI::EvaluateController, raises the lower
+// bound of its belief and the children tighten the upper bounds.
+// Trials run concurrently; each one adds a virtual loss to the beliefs it goes through
+// so that the others pick different branches. Backups are serialized.
+class BeliefTreeSearch
+{
+private:
+    MCVI *mcvi;
+    SimInterface *sim;
+    const BoundInterface *bounds;
+    BeliefTreeParameters params;
+    int A_size;
+    int Obs_size;
+    double discount;
+
+    vector<unique_ptr<BeliefTreeNode>> nodes;
+    mutex tree_mutex;
+    mutex backup_mutex;
+    vector<unique_ptr<SimInterface>> owned_sims;
+    // simulator of each concurrent trial, empty when trials run one at a time on sim
+    vector<SimInterface *> trial_sims;
+    // scheduler and simulator of each worker for the expansions of single trials
+    unique_ptr<WorkStealingScheduler> expand_scheduler;
+    vector<SimInterface *> expand_sims;
+    int nb_trials = 0;
+    ostream *log = nullptr;
+
+    int AddNode(const vector<int> &particles, int depth);
+    // sample the children of every action of belief id; false if another trial did it first
+    bool Expand(int id, SimInterface *sim);
+    double GetQUpper(const BeliefTreeNode &node, int aI) const;
+    // forward part of a trial, returns the beliefs it went through, each with a virtual loss
+    vector<int> Descend(SimInterface *sim, double epsilon);
+    // back up the beliefs of the paths from their ends and update their bounds
+    void BackUpPaths(const vector<vector<int>> &paths);
+
+public:
+    BeliefTreeSearch(MCVI *mcvi, SimInterface *sim, const BoundInterface *bounds,
+                     const BeliefTreeParameters &params);
+    ~BeliefTreeSearch();
+
+    // run trials until the gap at b0 is below epsilon or max_trials have been run,
+    // returns the number of trials
+    int Search(int max_trials, double epsilon);
+
+    double GetUpperBound() const;
+    double GetLowerBound() const;
+    int GetNbBeliefs() const;
+    // write a line per trial to log, nullptr (the default) for none
+    void SetLog(ostream *log);
+};
+
+#endif /* !_BELIEFTREESEARCH_H_ */
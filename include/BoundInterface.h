@@ -0,0 +1,26 @@
+/* This file has been written and/or modified by the following people:
+ *
+ * Yang You
+ * Alex Schutz
+ *
+ */
+
+#ifndef _BOUNDINTERFACE_H_
+#define _BOUNDINTERFACE_H_
+
+#include <vector>
+
+using namespace std;
+
+// Value bounds at particle beliefs, used to measure how far planning is from optimal.
+class BoundInterface
+{
+public:
+    BoundInterface(){};
+    virtual ~BoundInterface(){};
+
+    virtual double GetUpperBound(const vector<int> &particles) const = 0;
+    virtual double GetLowerBound(const vector<int> &particles) const = 0;
+};
+
+#endif /* !_BOUNDINTERFACE_H_ */
@@ -0,0 +1,83 @@
+/* This file has been written and/or modified by the following people:
+ *
+ * Yang You
+ * Alex Schutz
+ *
+ */
+
+#ifndef _DISTRIBUTEDEVALUATOR_H_
+#define _DISTRIBUTEDEVALUATOR_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "BackUpEvaluatorInterface.h"
+#include "MCVI.h"
+#include "MessageChannel.h"
+
+using namespace std;
+
+// Coordinator side of distributed backups: the sample jobs of a backup are handed out to
+// MCVIWorker processes, one job at a time to each worker and the next one to whichever
+// worker answers first, and the results are kept in job order, so they do not depend on
+// the number of workers. Each worker gets the controller as a versioned delta. A worker
+// that fails, or has not answered a job within the job timeout, is dropped and its job
+// handed to another one; without workers left the evaluation fails and the planner
+// evaluates the samples itself. At the deadline the jobs in flight are abandoned and
+// their results thrown away when they arrive.
+class DistributedEvaluator : public BackUpEvaluatorInterface
+{
+private:
+    struct WorkerLink
+    {
+        string address;
+        MessageChannel channel;
+        // controller version and backup whose belief the worker has
+        unsigned long controller_version = 0;
+        unsigned long belief_backup_id = 0;
+        bool has_belief = false;
+        unsigned long nb_jobs = 0;
+        // results of jobs abandoned at a deadline, still to be read and thrown away
+        int nb_stale = 0;
+    };
+
+    MCVIParameters params;
+    int A_size;
+    int Obs_size;
+    vector<unique_ptr<WorkerLink>> workers;
+    double job_timeout = 60.0;
+    unsigned long nb_bytes_sent = 0;
+    unsigned long nb_bytes_received = 0;
+    unsigned long nb_nodes_sent = 0;
+
+    bool SendJob(WorkerLink &worker, const FscPolicyTable &snapshot, const vector<unsigned long> &versions,
+                 unsigned long snapshot_version, const vector<int> &belief, const SampleJob &job);
+    bool ReadResult(WorkerLink &worker, int N, SampleJobResult &result);
+    bool DiscardResult(WorkerLink &worker);
+    void DropWorker(int w);
+
+public:
+    // params must be those of the planner, A_size and Obs_size those of the model
+    DistributedEvaluator(const MCVIParameters &params, int A_size, int Obs_size);
+    ~DistributedEvaluator();
+
+    // connect to a worker listening on address and check that it runs the same model
+    // and parameters; returns false if it cannot be used
+    bool AddWorker(const string &address, double timeout = 5.0);
+    int GetNbWorkers() const;
+    // seconds a worker may take for one job before it is considered stalled, 0 for no limit
+    void SetJobTimeout(double seconds);
+    // tell every worker to exit
+    void Shutdown();
+
+    bool EvaluateSamples(const FscPolicyTable &snapshot, const vector<unsigned long> &versions,
+                         const vector<int> &belief, const vector<SampleJob> &jobs,
+                         vector<SampleJobResult> &results, chrono::steady_clock::time_point deadline);
+
+    unsigned long GetNbBytesSent() const;
+    unsigned long GetNbBytesReceived() const;
+    // controller nodes sent in deltas
+    unsigned long GetNbNodesSent() const;
+};
+
+#endif /* !_DISTRIBUTEDEVALUATOR_H_ */
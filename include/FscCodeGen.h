@@ -0,0 +1,34 @@
+/* This file has been written and/or modified by the following people:
+ *
+ * Yang You
+ * Alex Schutz
+ *
+ */
+
+#ifndef _FSCCODEGEN_H_
+#define _FSCCODEGEN_H_
+
+#include <iostream>
+#include <string>
+#include "AlphaVectorFSC.h"
+
+using namespace std;
+
+// Generate a self-contained C++ header that compiles the controller into the binary.
+// Inside namespace `name` it defines
+//   constexpr kNodeSize, kSizeOfA, kSizeOfObs
+//   constexpr kActions[kNodeSize]            node -> action
+//   constexpr kEta[kNodeSize * kSizeOfObs]   (node, observation) -> next node
+//   inline int GetAction(int nI), inline int Step(int nI, int oI)
+// Only the edges of each node's executed action are kept. Unset edges are resolved to
+// the node itself, as in the planner's rollouts, so Step is a single table lookup.
+// Each table uses the smallest integer type holding its values. name must be a plain C++
+// identifier (see IsValidCppIdentifier), otherwise nothing is written and false returned.
+bool ExportFSCToCppHeader(const AlphaVectorFSC &fsc, ostream &os, const string &name = "mcvi_policy");
+bool ExportFSCToCppHeader(const AlphaVectorFSC &fsc, const string &filename, const string &name = "mcvi_policy");
+
+// true if name is usable as a namespace name: letters, digits and '_', not starting with a
+// digit, and not a keyword
+bool IsValidCppIdentifier(const string &name);
+
+#endif /* !_FSCCODEGEN_H_ */
@@ -0,0 +1,47 @@
+/* This file has been written and/or modified by the following people:
+ *
+ * Yang You
+ * Alex Schutz
+ *
+ */
+
+#ifndef _FSCMINIMIZATION_H_
+#define _FSCMINIMIZATION_H_
+
+#include <iostream>
+#include <vector>
+#include "AlphaVectorFSC.h"
+
+using namespace std;
+
+struct FscMinimizationReport
+{
+    int nodes_before = 0;
+    int nodes_after = 0;
+    int unreachable_removed = 0;
+    int equivalent_merged = 0;
+    // nodes merged only because their values were within epsilon
+    int epsilon_merged = 0;
+    // the minimized controller executes exactly the same policy from node 0
+    bool policy_preserved = false;
+};
+
+// Minimize fsc in place. Only the edges of each node's executed action matter for the
+// policy, and an unset edge keeps the current node, as in the planner's rollouts.
+//  1. nodes unreachable from the start node 0 are removed
+//  2. behaviourally equivalent nodes (same action, equivalent successors for every
+//     observation) are merged by partition refinement, as in DFA minimization
+//  3. if value_epsilon > 0, nodes with the same action whose values differ by less than
+//     value_epsilon are merged as well and the refinement is repeated; this step
+//     changes the policy, so policy_preserved is then only true if nothing was merged
+// node_map (optional) receives the new index of every original node, -1 if removed.
+FscMinimizationReport MinimizeFSC(AlphaVectorFSC &fsc, double value_epsilon = 0.0, vector<int> *node_map = nullptr);
+
+// check step for step that minimized, started from node_map[0], executes the same
+// actions as original for every observation sequence
+bool CheckPolicyEquivalence(const AlphaVectorFSC &original, const AlphaVectorFSC &minimized,
+                            const vector<int> &node_map);
+
+void PrintMinimizationReport(const FscMinimizationReport &report, ostream &os = cout);
+
+#endif /* !_FSCMINIMIZATION_H_ */
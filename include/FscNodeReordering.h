@@ -0,0 +1,41 @@
+/* This file has been written and/or modified by the following people:
+ *
+ * Yang You
+ * Alex Schutz
+ *
+ */
+
+#ifndef _FSCNODEREORDERING_H_
+#define _FSCNODEREORDERING_H_
+
+#include <cstdint>
+#include <vector>
+#include "AlphaVectorFSC.h"
+#include "SimInterface.h"
+
+using namespace std;
+
+// node and edge visit counts of a controller executed from node 0
+struct FscVisitProfile
+{
+    vector<uint64_t> node_visits;
+    // edge_visits[nI * |O| + oI] counts the transitions taken out of nI on oI
+    vector<uint64_t> edge_visits;
+    uint64_t nb_steps = 0;
+};
+
+// run nb_runs rollouts of at most L steps from node 0 and sim->SampleStartState()
+// and record the visited nodes and edges (unset edges keep the current node)
+FscVisitProfile ProfileNodeVisits(const AlphaVectorFSC &fsc, SimInterface *sim, int nb_runs, int L);
+
+// Layout order for the profiled nodes: node 0 stays first, then chains are built by
+// repeatedly following the most frequent edge out of the last placed node, and starting
+// a new chain at the hottest remaining node when the chain ends. Unvisited nodes keep
+// their relative order at the end. Returns new_index[nI] for AlphaVectorFSC::Renumber.
+vector<int> ComputeNodeLayout(const AlphaVectorFSC &fsc, const FscVisitProfile &profile);
+
+// profile and renumber fsc so that hot nodes and their common successors are contiguous,
+// returns the permutation that was applied
+vector<int> ReorderFSCByVisits(AlphaVectorFSC &fsc, SimInterface *sim, int nb_runs, int L);
+
+#endif /* !_FSCNODEREORDERING_H_ */
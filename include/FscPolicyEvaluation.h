@@ -0,0 +1,81 @@
+/* This file has been written and/or modified by the following people:
+ *
+ * Yang You
+ * Alex Schutz
+ *
+ */
+
+#ifndef _FSCPOLICYEVALUATION_H_
+#define _FSCPOLICYEVALUATION_H_
+
+#include <iostream>
+#include <map>
+#include <vector>
+#include "AlphaVectorFSC.h"
+#include "PomdpInterface.h"
+#include "WorkStealingScheduler.h"
+
+using namespace std;
+
+// Exact value of a controller on an explicit model, by solving the linear system over
+// (node, state) pairs
+//   V(n,s) = R(s,a_n) + gamma * sum_{s',o} T(s,a_n,s') O(o|s',a_n) V(eta(n,a_n,o), s')
+// with Gauss-Seidel sweeps. Nodes are split into blocks, several per thread since the
+// cost of a node depends on the sparsity of its action, run on a work-stealing scheduler:
+// a block is updated in place and reads the other blocks from the previous sweep.
+// An unset edge keeps the current node, and nodes without an action have value 0.
+class FscPolicyEvaluator
+{
+private:
+    const PomdpInterface *pomdp;
+    int S_size;
+    int A_size;
+    int Obs_size;
+    double discount;
+    WorkStealingScheduler scheduler;
+
+    // CSR transition rows per (a, s): successor states and probabilities
+    vector<int> trans_start;
+    vector<int> trans_state;
+    vector<double> trans_prob;
+    // CSR observation rows per (a, s'): observations and probabilities
+    vector<int> obs_start;
+    vector<int> obs_id;
+    vector<double> obs_prob;
+
+    // node-major values, values[nI * |S| + sI]
+    vector<double> values;
+    int nb_nodes = 0;
+    int last_iterations = 0;
+    double last_residual = 0.0;
+
+    void BuildSparseModel();
+    double Sweep(const vector<int> &actions, const vector<int> &successors, int n_begin, int n_end,
+                 const vector<double> &previous);
+
+public:
+    FscPolicyEvaluator(const PomdpInterface *pomdp, int nb_threads = 1);
+    ~FscPolicyEvaluator();
+
+    // Solve for the values of fsc until the largest update is below tolerance. Values
+    // from the previous call are kept as a warm start for the nodes that already
+    // existed, which is valid as long as the controller only grew by appending nodes;
+    // call Reset() after renumbering it. Returns the number of sweeps.
+    int Evaluate(const AlphaVectorFSC &fsc, double tolerance = 1e-6, int max_iterations = 100000);
+    void Reset();
+    // static blocks per thread instead of work stealing, to compare the load balance
+    void SetWorkStealing(bool stealing);
+    // load balance of the sweeps of the last Evaluate()
+    SchedulerStats GetSchedulerStats() const;
+
+    int GetNodeSize() const;
+    int GetLastIterations() const;
+    double GetLastResidual() const;
+    double GetValue(int nI, int sI) const;
+    // value of node nI at a sparse belief (e.g. GetInitBeliefSparse()) or at a particle belief
+    double GetValue(int nI, const map<int, double> &belief) const;
+    double GetValue(int nI, const vector<int> &particles) const;
+    const vector<double> &GetValues() const;
+};
+
+#endif /* !_FSCPOLICYEVALUATION_H_ */
@@ -0,0 +1,186 @@
+/* This file has been written and/or modified by the following people:
+ *
+ * Yang You
+ * Alex Schutz
+ *
+ */
+
+#ifndef _FSCRUNTIME_H_
+#define _FSCRUNTIME_H_
+
+#include <cstdint>
+#include <vector>
+
+using namespace std;
+
+// Header-only execution of a solved controller: the node's action is executed, then
+// eta is followed on the received observation. Nothing here allocates after setup.
+
+// what to do when eta has no edge for the executed action and received observation
+enum class FscEdgeFallback
+{
+    Stay,      // keep the current node (same convention as the planner's rollouts)
+    Restart,   // go back to the start node 0
+    FixedNode, // go to a configured node
+};
+
+// non-owning view over flat action and eta tables
+struct FscPolicyView
+{
+    const int32_t *actions = nullptr;
+    const int32_t *eta = nullptr;
+    int32_t node_size = 0;
+    int32_t A_size = 0;
+    int32_t Obs_size = 0;
+    FscEdgeFallback fallback = FscEdgeFallback::Stay;
+    int32_t fallback_node = 0;
+
+    inline int GetAction(int nI) const
+    {
+        return actions[nI];
+    }
+
+    // A node without action (-1, never backed up) has no row of edges to follow: it is
+    // kept, whatever the fallback, like an unset edge in AlphaVectorFSC::GetEtaValue is
+    // kept by the planner's rollouts. GetAction returns -1 for it, the caller decides what
+    // to execute.
+    inline int GetNextNode(int nI, int aI, int oI) const
+    {
+        if (aI < 0)
+            return nI;
+        int32_t n_next = eta[((size_t)nI * A_size + aI) * Obs_size + oI];
+        if (n_next >= 0)
+            return n_next;
+        switch (fallback)
+        {
+        case FscEdgeFallback::Restart:
+            return 0;
+        case FscEdgeFallback::FixedNode:
+            return fallback_node;
+        default:
+            return nI;
+        }
+    }
+
+    // next node after executing the node's own action and receiving oI
+    inline int Step(int nI, int oI) const
+    {
+        return GetNextNode(nI, actions[nI], oI);
+    }
+};
+
+// owning flat copy of a controller, built from anything exposing GetNodeSize,
+// GetSizeOfA, GetSizeOfObs, GetBestAction and GetEtaValue (AlphaVectorFSC, MappedFSC)
+class FscPolicyTable
+{
+private:
+    vector<int32_t> actions;
+    vector<int32_t> eta;
+    int32_t node_size = 0;
+    int32_t A_size = 0;
+    int32_t Obs_size = 0;
+
+public:
+    FscPolicyTable(){};
+    template <class Controller>
+    explicit FscPolicyTable(const Controller &fsc)
+        : node_size(fsc.GetNodeSize()), A_size(fsc.GetSizeOfA()), Obs_size(fsc.GetSizeOfObs())
+    {
+        actions.resize(node_size);
+        eta.resize((size_t)node_size * A_size * Obs_size);
+        size_t i = 0;
+        for (int nI = 0; nI < node_size; nI++)
+        {
+            actions[nI] = fsc.GetBestAction(nI);
+            for (int aI = 0; aI < A_size; aI++)
+                for (int oI = 0; oI < Obs_size; oI++)
+                    eta[i++] = fsc.GetEtaValue(nI, aI, oI);
+        }
+    }
+
+    int GetNodeSize() const { return node_size; }
+    int GetSizeOfA() const { return A_size; }
+    int GetSizeOfObs() const { return Obs_size; }
+    int GetBestAction(int nI) const { return actions[nI]; }
+    int GetEtaValue(int nI, int aI, int oI) const { return eta[((size_t)nI * A_size + aI) * Obs_size + oI]; }
+
+    FscPolicyView GetView(FscEdgeFallback fallback = FscEdgeFallback::Stay, int fallback_node = 0) const
+    {
+        FscPolicyView view;
+        view.actions = actions.data();
+        view.eta = eta.data();
+        view.node_size = node_size;
+        view.A_size = A_size;
+        view.Obs_size = Obs_size;
+        view.fallback = fallback;
+        view.fallback_node = fallback_node;
+        return view;
+    }
+};
+
+// view directly over a mapped controller (e.g. MappedFSC::GetActionTable / GetEtaTable)
+inline FscPolicyView MakeFscPolicyView(const int32_t *actions, const int32_t *eta, int node_size, int A_size,
+                                       int Obs_size, FscEdgeFallback fallback = FscEdgeFallback::Stay,
+                                       int fallback_node = 0)
+{
+    FscPolicyView view;
+    view.actions = actions;
+    view.eta = eta;
+    view.node_size = node_size;
+    view.A_size = A_size;
+    view.Obs_size = Obs_size;
+    view.fallback = fallback;
+    view.fallback_node = fallback_node;
+    return view;
+}
+
+// many concurrent executions of the same controller, one int32 node per instance
+class FscInstanceArray
+{
+private:
+    FscPolicyView policy;
+    vector<int32_t> current_nodes;
+
+public:
+    FscInstanceArray(const FscPolicyView &policy, int nb_instances)
+        : policy(policy), current_nodes(nb_instances, 0)
+    {
+    }
+
+    int GetSize() const { return current_nodes.size(); }
+    int GetCurrentNode(int i) const { return current_nodes[i]; }
+    void Reset(int i, int nI = 0) { current_nodes[i] = nI; }
+    void ResetAll(int nI = 0) { current_nodes.assign(current_nodes.size(), nI); }
+
+    // action to execute for instance i
+    inline int GetAction(int i) const
+    {
+        return policy.GetAction(current_nodes[i]);
+    }
+
+    // instance i received observation oI after executing GetAction(i)
+    inline void Step(int i, int oI)
+    {
+        current_nodes[i] = policy.Step(current_nodes[i], oI);
+    }
+
+    // step every instance, obs[i] is the observation received by instance i
+    inline void StepAll(const int *obs)
+    {
+        const int n = current_nodes.size();
+        int32_t *nodes = current_nodes.data();
+        for (int i = 0; i < n; i++)
+            nodes[i] = policy.Step(nodes[i], obs[i]);
+    }
+
+    // actions[i] = action to execute for instance i
+    inline void GetAllActions(int *actions) const
+    {
+        const int n = current_nodes.size();
+        const int32_t *nodes = current_nodes.data();
+        for (int i = 0; i < n; i++)
+            actions[i] = policy.actions[nodes[i]];
+    }
+};
+
+#endif /* !_FSCRUNTIME_H_ */
@@ -0,0 +1,101 @@
+/* This file has been written and/or modified by the following people:
+ *
+ * Yang You
+ * Alex Schutz
+ *
+ */
+
+#ifndef _FSCSERIALIZATION_H_
+#define _FSCSERIALIZATION_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "AlphaVectorFSC.h"
+
+using namespace std;
+
+// Binary controller file, version 1. All integers are little-endian and every
+// section starts on a 64-byte boundary so that it can be used in place once mapped:
+//   header | int32 actions[N] | int32 eta[N*A*O] | double values[N]
+//          | uint64 belief_index[N+1] | uint8 belief_data[]
+// Beliefs are optional. Each node's particles are stored as a sorted histogram of
+// (state delta, count) pairs, both LEB128 varint encoded.
+const char FSC_FILE_MAGIC[8] = {'M', 'C', 'V', 'I', 'F', 'S', 'C', '\0'};
+const uint32_t FSC_FILE_VERSION = 1;
+const uint32_t FSC_FILE_FLAG_BELIEFS = 1u;
+
+struct FscFileHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t flags;
+    uint32_t A_size;
+    uint32_t Obs_size;
+    uint64_t node_size;
+    uint64_t actions_offset;
+    uint64_t eta_offset;
+    uint64_t values_offset;
+    uint64_t belief_index_offset;
+    uint64_t belief_data_offset;
+    uint64_t belief_data_size;
+    uint64_t file_size;
+};
+
+// write fsc to filename, returns false on I/O failure
+bool SaveFSCBinary(const AlphaVectorFSC &fsc, const string &filename, bool with_beliefs = true);
+
+// largest particle set DecompressBelief() accepts, so that corrupt counts cannot ask for
+// an arbitrary allocation
+const size_t FSC_MAX_BELIEF_PARTICLES = (size_t)1 << 26;
+
+// encode / decode a particle set with the belief compression used in the file; decoding
+// fails on states above INT_MAX and on more than FSC_MAX_BELIEF_PARTICLES particles
+void CompressBelief(const vector<int> &particles, vector<uint8_t> &out);
+bool DecompressBelief(const uint8_t *data, size_t size, vector<int> &particles);
+
+// Read-only controller mapped from a file written by SaveFSCBinary. Load checks the
+// header and that every action is in [-1, A) and every edge is -1 or in [0, N), nothing
+// is copied: the accessors read straight from the shared mapping, so several processes
+// loading the same file share its pages. Beliefs are checked when they are decoded.
+class MappedFSC
+{
+private:
+    const uint8_t *base = nullptr;
+    size_t mapped_size = 0;
+    const FscFileHeader *header = nullptr;
+    const int32_t *actions = nullptr;
+    const int32_t *eta = nullptr;
+    const double *values = nullptr;
+    const uint64_t *belief_index = nullptr;
+    const uint8_t *belief_data = nullptr;
+
+public:
+    MappedFSC(){};
+    ~MappedFSC();
+    MappedFSC(const MappedFSC &) = delete;
+    MappedFSC &operator=(const MappedFSC &) = delete;
+
+    // map filename and check its header, returns false if the file is not a valid controller
+    bool Load(const string &filename);
+    void Unload();
+    bool IsLoaded() const;
+
+    int GetNodeSize() const;
+    int GetSizeOfA() const;
+    int GetSizeOfObs() const;
+    bool HasBeliefs() const;
+    int GetBestAction(int nI) const;
+    int GetEtaValue(int nI, int aI, int oI) const;
+    double GetNodeValue(int nI) const;
+    bool GetBelief(int nI, vector<int> &particles) const;
+    // raw sections, for building execution views on top of the mapping
+    const int32_t *GetActionTable() const;
+    const int32_t *GetEtaTable() const;
+
+    // copy the mapped controller into an in-memory FSC (Q and R values are not stored),
+    // returns false if a belief cannot be decoded
+    bool ToFSC(AlphaVectorFSC &fsc) const;
+};
+
+#endif /* !_FSCSERIALIZATION_H_ */
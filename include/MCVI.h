@@ -2,32 +2,416 @@
  *
  * Yang You
  * Alex Schutz
- * 
+ *
  */
 
 #ifndef _MCVIPLANNER_H_
 #define _MCVIPLANNER_H_
 
+#include <atomic>
+#include <chrono>
 #include <iostream>
-#include "PomdpInterface.h"
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <vector>
+#include "AlphaVectorFSC.h"
+#include "BackUpEvaluatorInterface.h"
+#include "BatchedRollout.h"
+#include "BoundInterface.h"
+#include "FscPolicyEvaluation.h"
+#include "FscRuntime.h"
+#include "PlannerCheckpoint.h"
+#include "PolicyPublisher.h"
+#include "RolloutValueCache.h"
+#include "RunningStat.h"
+#include "SimInterface.h"
+#include "TrajectoryStore.h"
+#include "WorkStealingScheduler.h"
 
-class MCVI
+struct MCVIParameters
 {
-private:
-    /* data */
-public:
-    MCVI(/* args */);
-    ~MCVI();
+    // particles of the initial belief
+    int nb_particles = 1000;
+    // samples per action in a backup
+    int nb_sample = 100;
+    // rollout length
+    int L = 50;
+    // cut rollouts once the reward left in them is bounded by this (needs reward bounds
+    // from the simulator), 0 always runs L steps
+    double rollout_tolerance = 0.0;
+    // worker threads for backups, the simulator must implement Clone() to use more than one
+    int nb_threads = 1;
+    // The samples of each action are split into nb_threads * tasks_per_thread tasks, dealt
+    // to the workers in contiguous blocks; with work_stealing an idle worker takes the
+    // tasks left to the others, e.g. when their rollouts end late. Results do not depend
+    // on work_stealing.
+    bool work_stealing = true;
+    int tasks_per_thread = 8;
+    unsigned long seed = 0;
+    // node budget, 0 means unbounded, at least 2 otherwise (1 is raised to 2)
+    int max_node_size = 0;
+    FscReplacementPolicy replacement_policy = FscReplacementPolicy::LeastVisited;
+    // evaluate all candidate nodes of a sample in lockstep, sharing simulator calls
+    bool batched_rollouts = true;
+    // drive all actions and candidate nodes of sample i from the same random stream:
+    // same start particle, and the same simulator seed at every rollout step
+    bool common_random_numbers = false;
+    // error probability for the reported number of samples needed to pick the best action
+    double decision_delta = 0.05;
+    // Racing: actions are sampled in rounds of race_round_size, and an action is dropped
+    // once its upper confidence bound is below the best lower bound; the bounds hold jointly
+    // with probability 1 - race_delta. Actions left in the race draw all nb_sample samples.
+    bool action_racing = false;
+    int race_round_size = 20;
+    double race_delta = 0.05;
+    // Cache the rollout values of (node, state) pairs across samples and backups. A cached
+    // value is used once it has rollout_cache_min_count rollouts (at least two) and the
+    // variance of its mean is at most rollout_cache_variance, or once it has
+    // rollout_cache_max_count rollouts. With several
+    // threads the cache contents depend on scheduling, so results are not reproducible.
+    bool rollout_cache = false;
+    double rollout_cache_variance = 1.0;
+    int rollout_cache_min_count = 10;
+    int rollout_cache_max_count = 100;
+    size_t rollout_cache_size = 1 << 18;
+    // Keep the samples of the last trajectory_store_beliefs beliefs. A later backup of the
+    // same belief reuses their first steps and replays their rollouts as long as the
+    // controller takes the same actions, simulating only from the first changed step.
+    // Rollouts are then run per node. The rollout cache takes precedence: with it on, no
+    // trajectories are kept. The store is trimmed to trajectory_store_bytes (0 for no bound)
+    // after each backup, least recently used beliefs first, and a sample replayed by
+    // trajectory_store_max_reuse backups (0 for no limit) is drawn again, so that a belief
+    // backed up many times does not keep the same first steps forever.
+    bool reuse_trajectories = false;
+    int trajectory_store_beliefs = 16;
+    size_t trajectory_store_bytes = (size_t)256 << 20;
+    int trajectory_store_max_reuse = 10;
+    // BackUpConcurrent(): times a backup is evaluated again when a node it read changed
+    // before its commit, after which it is discarded
+    int max_backup_retries = 2;
+    // samples per job handed to an evaluator (see SetEvaluator); the sums of the jobs are
+    // added in job order, so results depend on this but not on the number of workers
+    int samples_per_job = 25;
+    // Lower bound of the controller at b0 (see EvaluateController): the mean return of
+    // nb_eval_rollouts rollouts, on seeds of their own, minus a one-sided normal margin at
+    // level eval_delta and the reward past the rollouts in the worst case. With reward
+    // bounds, rollouts are made long enough for that reward to be below eval_tolerance, up
+    // to eval_max_horizon steps; without, they run L steps and nothing is subtracted. Backup
+    // values are not bounds: each is a maximum over noisy action estimates, biased upwards.
+    int nb_eval_rollouts = 500;
+    double eval_delta = 0.05;
+    double eval_tolerance = 0.01;
+    int eval_max_horizon = 1000;
+};
+
+// counters of the last backup
+struct MCVIBackUpStats
+{
+    unsigned long nb_sim_calls = 0;
+    int nb_candidate_nodes = 0;
+    // value of the belief estimated by the backup
+    double backup_value = 0.0;
+    // Per-sample return differences between the best action and the hardest competitor:
+    // mean gap, its standard deviation, and the samples needed so that the best action
+    // is chosen with probability 1 - decision_delta (normal approximation, union bound
+    // over the competitors). Infinite when the gap is zero.
+    double action_gap = 0.0;
+    double action_gap_stddev = 0.0;
+    double nb_sample_needed = 0.0;
+    // samples drawn over all actions, and those racing saved against A * nb_sample
+    unsigned long nb_samples_used = 0;
+    unsigned long nb_samples_saved = 0;
+    int nb_actions_eliminated = 0;
+    // rollout length used, bound of the value lost by cutting rollouts at that length, and
+    // trajectory steps skipped by the cut and by terminal states
+    int rollout_horizon = 0;
+    double rollout_precision_loss = 0.0;
+    unsigned long nb_steps_saved = 0;
+    // node values taken from the rollout cache without new rollouts, and rollouts of all
+    // nodes run to top up the cache
+    unsigned long nb_cache_hits = 0;
+    unsigned long nb_cache_rollouts = 0;
+    // samples taken from the trajectory store, rollout steps replayed from it, rollouts
+    // reused entirely, and rollouts resumed after a still valid prefix
+    unsigned long nb_reused_samples = 0;
+    unsigned long nb_replayed_steps = 0;
+    unsigned long nb_trajectories_reused = 0;
+    unsigned long nb_trajectories_resumed = 0;
+    // busiest worker time over mean worker time in the sample loops (1 = balanced), and
+    // tasks taken from another worker
+    double load_imbalance = 1.0;
+    unsigned long nb_steals = 0;
+    // BackUpConcurrent(): evaluations rejected at commit, and backups given up
+    int nb_conflicts = 0;
+    int nb_discarded = 0;
+};
+
+void PrintBackUpStats(const MCVIBackUpStats &stats, ostream &os = cout);
+
+// value of a controller node at a belief, estimated independently of the backups
+struct ControllerEvaluation
+{
+    // mean return and its standard error; exact evaluations have no error
+    double value = 0.0;
+    double stderr_value = 0.0;
+    // holds with probability 1 - eval_delta, or up to the solver tolerance when exact;
+    // -infinity for a node without action
+    double lower = -numeric_limits<double>::infinity();
+    int nb_rollouts = 0;
+    unsigned long nb_sim_calls = 0;
+    bool exact = false;
+    // the budget of MCVIPlanningAnytime() ran out during the rollouts, the estimate is
+    // left at its defaults
+    bool interrupted = false;
+};
+
+// limits of MCVIPlanningAnytime(), 0 means no limit
+struct AnytimeBudget
+{
+    // wall-clock seconds
+    double time_limit = 0.0;
+    // simulator calls of all backups and evaluations, including the one interrupted
+    unsigned long max_sim_calls = 0;
+    // stop once the upper minus the lower bound at b0 is below target_gap (needs SetBounds)
+    double target_gap = 0.0;
+    int max_iterations = 0;
 };
 
-MCVI::MCVI(/* args */)
+enum class AnytimeStop
 {
-}
+    TargetGap,
+    Deadline,
+    SimCalls,
+    Iterations
+};
 
-MCVI::~MCVI()
+struct AnytimeResult
 {
-}
+    // best controller completed within the budget and its value at b0 by
+    // MCVI::EvaluateController; without any completed backup the controller has no node
+    AlphaVectorFSC fsc;
+    double value = -numeric_limits<double>::infinity();
+    // bounds at b0, lower is the best of the evaluated lower bound of fsc and the lower
+    // bound; without bounds upper is infinite
+    double lower = -numeric_limits<double>::infinity();
+    double upper = numeric_limits<double>::infinity();
+    double gap = numeric_limits<double>::infinity();
+    int nb_iterations = 0;
+    unsigned long nb_sim_calls = 0;
+    double elapsed = 0.0;
+    AnytimeStop stop = AnytimeStop::Iterations;
+};
+
+// Monte Carlo Value Iteration: backups at particle beliefs add nodes to an FSC whose
+// candidate successors are evaluated by rollouts through the current controller.
+class MCVI
+{
+private:
+    SimInterface *sim;
+    MCVIParameters params;
+    AlphaVectorFSC fsc;
+    WorkStealingScheduler pool;
+    // simulator of each worker, worker 0 uses sim itself
+    vector<SimInterface *> worker_sims;
+    vector<unique_ptr<SimInterface>> owned_sims;
+    // lockstep rollout buffers of each worker
+    vector<BatchedRollout> worker_rollouts;
+    MCVIBackUpStats last_backup_stats;
+    // largest absolute immediate reward, if the simulator declares reward bounds
+    bool has_reward_bounds = false;
+    double reward_abs_max = 0.0;
+    vector<int> b0;
+    unsigned long nb_backups = 0;
+    PolicyPublisher *publisher = nullptr;
+    unique_ptr<RolloutValueCache> rollout_cache;
+    unique_ptr<TrajectoryStore> trajectory_store;
+    const BoundInterface *bounds = nullptr;
+    double last_gap = numeric_limits<double>::infinity();
+    // Version of each node, bumped whenever the node or its edges change or its index
+    // names another node. Snapshots are taken under a shared lock, commits under an
+    // exclusive one.
+    vector<unsigned long> node_versions;
+    unsigned long version_clock = 0;
+    shared_mutex fsc_mutex;
+    BackUpEvaluatorInterface *evaluator = nullptr;
+    FscPolicyEvaluator *exact_evaluator = nullptr;
+    // controller evaluations so far, each draws from its own seeds; checkpoints read it
+    // while evaluations may run
+    atomic<unsigned long> nb_evaluations{0};
+    ostream *log = nullptr;
+    // budget of MCVIPlanningAnytime(), checked before every sample of a backup and every
+    // rollout of a controller evaluation
+    bool budget_active = false;
+    bool budget_has_deadline = false;
+    chrono::steady_clock::time_point budget_deadline;
+    unsigned long budget_max_sim_calls = 0;
+    atomic<unsigned long> budget_sim_calls{0};
+    atomic<bool> budget_exhausted{false};
+    // planning iterations over all runs, and the start value estimated by the last one
+    int nb_iterations = 0;
+    double last_start_value = 0.0;
+    CheckpointWriter *checkpoint = nullptr;
+    int checkpoint_every = 1;
+    // what the checkpoint blocks written so far hold: controller version, visits of
+    // each node and whether b0 is in them; checkpoint_mutex serializes the blocks
+    mutex checkpoint_mutex;
+    unsigned long checkpoint_version = 0;
+    vector<unsigned long> checkpoint_visits;
+    bool checkpoint_has_b0 = false;
+    // best controller of MCVIPlanningAnytime() over all runs, with its evaluated value and
+    // lower bound at b0, under checkpoint_mutex; changed since the last checkpoint block
+    // if anytime_changed
+    AlphaVectorFSC anytime_fsc;
+    double anytime_value = -numeric_limits<double>::infinity();
+    double anytime_lower = -numeric_limits<double>::infinity();
+    bool anytime_changed = false;
 
+    // per-task counters of a backup, summed into last_backup_stats
+    struct TaskCounters
+    {
+        unsigned long nb_sim_calls = 0;
+        unsigned long nb_steps_saved = 0;
+        unsigned long nb_cache_hits = 0;
+        unsigned long nb_cache_rollouts = 0;
+        unsigned long nb_reused_samples = 0;
+        unsigned long nb_replayed_steps = 0;
+        unsigned long nb_trajectories_reused = 0;
+        unsigned long nb_trajectories_resumed = 0;
+    };
 
+    // a backup evaluated against a snapshot of the controller, not committed yet
+    struct PendingBackUp
+    {
+        FscNode node;
+        vector<int> edges;
+        // nodes the evaluation depends on, with their versions at the snapshot
+        vector<int> read_nodes;
+        vector<unsigned long> read_versions;
+        vector<unsigned long> visits;
+        MCVIBackUpStats stats;
+        // the budget ran out before all samples were drawn, nothing to commit
+        bool aborted = false;
+    };
+
+    void AddStartNode(const vector<int> &belief);
+    void BumpNodeVersion(int nI);
+    // evaluate the backup at belief; concurrent evaluations use neither the rollout cache
+    // nor the trajectory store
+    void EvaluateBackUp(const vector<int> &belief, unsigned long backup_id, bool concurrent,
+                        PendingBackUp &pending);
+    bool IsBackUpValid(const PendingBackUp &pending) const;
+    // true once the deadline or the simulator call budget is reached, safe from the workers
+    bool IsBudgetExhausted();
+    // add the node of pending (or find an equivalent one), returns its index
+    int CommitBackUp(const PendingBackUp &pending);
+    double SimulateTrajectory(int nI, int sI, int horizon, const FscPolicyView &policy, SimInterface *sim,
+                              const unsigned long *step_seeds, vector<unsigned long> &visits,
+                              TaskCounters &counters, StoredTrajectory *traj = nullptr) const;
+    void RolloutNodes(const FscPolicyView &policy, int sI, int horizon, SimInterface *sim, BatchedRollout &rollout,
+                      const unsigned long *step_seeds, double *V_n, vector<unsigned long> &visits,
+                      TaskCounters &counters) const;
+    void EstimateNodeValues(const FscPolicyView &policy, int sI, int horizon, SimInterface *sim,
+                            BatchedRollout &rollout, const unsigned long *step_seeds, double *V_n,
+                            vector<double> &V_tmp, vector<unsigned long> &visits, TaskCounters &counters) const;
+    void EvaluateSample(const FscPolicyView &policy, const vector<int> &belief, unsigned long backup_id, int aI, int i,
+                        int horizon, SimInterface *sim, BatchedRollout &rollout, StoredSample *stored, bool use_cache,
+                        vector<unsigned long> &step_seeds, vector<double> &V_tmp, double *V_n, double &r, int &oI,
+                        vector<unsigned long> &visits, TaskCounters &counters) const;
+    // drop the cached values of nI and of every node whose policy can reach it
+    void InvalidateCachedValues(int nI);
+    // shortest rollout length whose remaining discounted reward is within rollout_tolerance,
+    // and the bound of that remainder
+    int ComputeRolloutHorizon(double &precision_loss) const;
+    int FindMaxValueNode(const double *V_n, int nb_nodes) const;
+    // write a checkpoint if one is due after the current planning iteration
+    void CheckpointIteration();
+    // fill the decision part of stats from the per-sample returns G[aI*nb_sample + i]
+    // of the first nb_done[aI] samples of each action
+    void ComputeDecisionStats(const vector<double> &G, const vector<int> &nb_done, int a_best,
+                              MCVIBackUpStats &stats) const;
+
+public:
+    MCVI(SimInterface *sim, const MCVIParameters &params);
+    ~MCVI();
+
+    // sample nb_particles start states
+    vector<int> SampleStartBelief(int nb_particles);
+    // back up the controller at belief, returns the index of the resulting node, or -1 if
+    // the budget of MCVIPlanningAnytime() ran out during the backup
+    int BackUp(const vector<int> &belief);
+    // Back up several beliefs at once, each evaluated against its own snapshot of the
+    // controller. A backup commits only if no node it read has changed since its snapshot,
+    // otherwise it is evaluated again, up to max_backup_retries times, then discarded.
+    // Returns the node of each belief, -1 if discarded or interrupted by the budget. The
+    // controller depends on the commit order, so results vary between runs with several
+    // threads. Each backup is a task whose sample tasks are nested in it; a backup waiting
+    // for its samples may run another backup of the batch meanwhile (see
+    // WorkStealingScheduler), so nesting is bounded by the batch size.
+    vector<int> BackUpConcurrent(const vector<vector<int>> &beliefs);
+    // Add samples [i_begin, i_end) of action aI of backup backup_id at belief, with rollouts
+    // of horizon steps through policy, into acc = [R sum | count per o | V sum per (o, n)]
+    // and visits; returns the simulator calls. This is the work of an evaluator job, run by
+    // worker processes; it uses neither the rollout cache nor the trajectory store.
+    unsigned long EvaluateSamples(const FscPolicyView &policy, const vector<int> &belief, unsigned long backup_id,
+                                  int aI, int i_begin, int i_end, int horizon, vector<double> &acc,
+                                  vector<unsigned long> &visits);
+    // make nI the start node 0 by swapping it with the current start node
+    void PromoteToStart(int nI);
+    // Repeatedly back up the initial belief and keep the result as start node, until
+    // max_iterations is reached or, with bounds, the gap at b0 between the upper bound and
+    // the best of the lower bound and the controller's evaluated lower bound is below
+    // epsilon; without bounds, until the start value changes by less than epsilon.
+    // Returns the number of iterations.
+    int MCVIPlanning(int max_iterations, double epsilon);
+    // Plan like MCVIPlanning() within budget and return the best controller completed so
+    // far, in this run, earlier ones or those of a restored checkpoint, with its bounds.
+    // Every controller is evaluated on its own by EvaluateController,
+    // whose simulator calls count in the budget, and the best evaluated value wins. The
+    // budget is checked before every sample, so a backup that runs out is dropped after at
+    // most one sample per worker; with an evaluator the workers are given up on at the
+    // deadline and the simulator calls are only checked before each backup. An evaluation
+    // is not interrupted. Without any limit it does not return.
+    AnytimeResult MCVIPlanningAnytime(const AnytimeBudget &budget);
+
+    const AlphaVectorFSC &GetFSC() const;
+    const vector<int> &GetInitBelief() const;
+    unsigned long GetNbBackups() const;
+    const MCVIBackUpStats &GetLastBackUpStats() const;
+    // bounds used to stop planning, computed by the caller; nullptr disables them
+    void SetBounds(const BoundInterface *bounds);
+    // upper minus lower bound at b0 after the last planning iteration
+    double GetLastGap() const;
+    // publish a snapshot after every planning iteration
+    void SetPublisher(PolicyPublisher *publisher);
+    // write a line per planning iteration to log, nullptr (the default) for none
+    void SetLog(ostream *log);
+    // evaluate the samples of sequential backups with evaluator, nullptr evaluates them here
+    void SetEvaluator(BackUpEvaluatorInterface *evaluator);
+    // Evaluate controllers exactly with evaluator (the simulator must be its model) instead
+    // of by rollouts; nullptr goes back to rollouts.
+    void SetExactEvaluator(FscPolicyEvaluator *evaluator);
+    // value of node nI of the controller at belief, by rollouts through the controller or
+    // by the exact evaluator; its lower bound is what planning compares with upper bounds
+    ControllerEvaluation EvaluateController(const vector<int> &belief, int nI = 0);
+    // largest node version, it increases with every change of the controller
+    unsigned long GetControllerVersion() const;
+    // planning iterations done so far, including those restored from a checkpoint
+    int GetNbIterations() const;
+    // append a checkpoint block to writer every every_iterations planning iterations,
+    // nullptr disables checkpoints
+    void SetCheckpoint(CheckpointWriter *writer, int every_iterations = 1);
+    // Queue a block with what changed since the last one: the nodes of a newer version,
+    // visit counts, b0, the counters and the best controller of MCVIPlanningAnytime().
+    // The nodes are copied here, compressed and written by the writer's thread. It may
+    // be called from another thread while backups run.
+    void WriteCheckpoint();
+    // Rebuild the planner from the blocks of filename. It must be a new planner with the
+    // simulator and parameters of the one that wrote them; planning then continues as it
+    // would have without the interruption. The rollout cache and the trajectory store are
+    // not saved, with them the results differ after a restore.
+    bool RestoreCheckpoint(const string &filename);
+};
 
-#endif /* !_MCVIPLANNER_H_ */
\ No newline at end of file
+#endif /* !_MCVIPLANNER_H_ */
@@ -0,0 +1,71 @@
+/* This file has been written and/or modified by the following people:
+ *
+ * Yang You
+ * Alex Schutz
+ *
+ */
+
+#ifndef _MCVIWORKER_H_
+#define _MCVIWORKER_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "MCVI.h"
+#include "MessageChannel.h"
+#include "SimInterface.h"
+
+using namespace std;
+
+// Protocol between DistributedEvaluator and MCVIWorker, version 2:
+//   HELLO    uint32 version | int32 A, O | uint64 seed | int32 L, nb_sample | uint8 crn, batched
+//   HELLO_OK (empty), or ERROR with a message
+//   JOB      uint64 backup_id | int32 aI, i_begin, i_end, horizon
+//            | uint64 base_version, new_version | int32 node_size, nb_changed
+//            | nb_changed x (int32 nI, action, eta[A * O])
+//            | uint8 has_belief [| uint64 size | int32 particles[size]]
+//   RESULT   uint64 nb_sim_calls | int32 N | double acc[1 + O + O * N] | uint64 visits[N]
+//   SHUTDOWN (empty)
+// The controller is sent as a delta: the nodes whose version is above base_version, the
+// version the worker already has. The belief is only sent with the first job of a backup.
+// A worker checks every job against its replica: actions in [-1, A), edges in [-1, N),
+// samples in [0, nb_sample) and a horizon of at most L.
+const uint32_t MCVI_PROTOCOL_VERSION = 2;
+
+// Worker process of a distributed planner: it holds its own model and simulator, keeps a
+// replica of the coordinator's controller, and evaluates the sample jobs it receives.
+// It must be built with the same parameters as the coordinator's planner.
+class MCVIWorker
+{
+private:
+    SimInterface *sim;
+    MCVIParameters params;
+    MCVI engine;
+    int A_size;
+    int Obs_size;
+
+    // replica of the controller, at version controller_version
+    vector<int32_t> actions;
+    vector<int32_t> eta;
+    int node_size = 0;
+    unsigned long controller_version = 0;
+    // belief of the current backup
+    unsigned long belief_backup_id = 0;
+    bool has_belief = false;
+    vector<int> belief;
+    unsigned long nb_jobs = 0;
+
+    bool HandleHello(const vector<uint8_t> &payload, string &error);
+    bool HandleJob(const vector<uint8_t> &payload, vector<uint8_t> &reply, string &error);
+
+public:
+    MCVIWorker(SimInterface *sim, const MCVIParameters &params);
+    ~MCVIWorker();
+
+    // listen on address and serve one coordinator until it sends SHUTDOWN or disconnects;
+    // returns false on a socket or protocol error
+    bool Serve(const string &address);
+    unsigned long GetNbJobs() const;
+};
+
+#endif /* !_MCVIWORKER_H_ */
@@ -0,0 +1,105 @@
+/* This file has been written and/or modified by the following people:
+ *
+ * Yang You
+ * Alex Schutz
+ *
+ */
+
+#ifndef _MESSAGECHANNEL_H_
+#define _MESSAGECHANNEL_H_
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// messages between the coordinator and the worker processes
+enum MessageType : uint32_t
+{
+    MSG_HELLO = 1,
+    MSG_HELLO_OK = 2,
+    MSG_JOB = 3,
+    MSG_RESULT = 4,
+    MSG_ERROR = 5,
+    MSG_SHUTDOWN = 6,
+};
+
+// appends plain values to a message payload, in host byte order
+struct MessageWriter
+{
+    vector<uint8_t> data;
+
+    template <class T>
+    void Put(const T &x)
+    {
+        this->PutArray(&x, 1);
+    }
+    template <class T>
+    void PutArray(const T *x, size_t n)
+    {
+        const uint8_t *p = reinterpret_cast<const uint8_t *>(x);
+        this->data.insert(this->data.end(), p, p + n * sizeof(T));
+    }
+};
+
+// reads the values written by MessageWriter; reading past the end fails and zero fills
+struct MessageReader
+{
+    const uint8_t *p;
+    const uint8_t *end;
+    bool ok = true;
+
+    explicit MessageReader(const vector<uint8_t> &data) : p(data.data()), end(data.data() + data.size()){};
+
+    template <class T>
+    bool Get(T &x)
+    {
+        return this->GetArray(&x, 1);
+    }
+    template <class T>
+    bool GetArray(T *x, size_t n)
+    {
+        if (!this->ok || (size_t)(this->end - this->p) < n * sizeof(T))
+        {
+            this->ok = false;
+            memset((void *)x, 0, n * sizeof(T));
+            return false;
+        }
+        memcpy((void *)x, this->p, n * sizeof(T));
+        this->p += n * sizeof(T);
+        return true;
+    }
+};
+
+// Framed messages over a stream socket: a header (type, payload size) followed by the
+// payload. Addresses are "unix:<path>" or "tcp:<host>:<port>". Payloads are in host byte
+// order, so both ends must share it.
+class MessageChannel
+{
+private:
+    int fd = -1;
+
+public:
+    MessageChannel(){};
+    explicit MessageChannel(int fd) : fd(fd){};
+    ~MessageChannel();
+    MessageChannel(const MessageChannel &) = delete;
+    MessageChannel &operator=(const MessageChannel &) = delete;
+
+    // bind and listen on address, returns the listening socket or -1
+    static int Listen(const string &address);
+    // wait for a connection on a listening socket
+    bool Accept(int listen_fd);
+    // connect to address, retrying until timeout seconds have passed
+    bool Connect(const string &address, double timeout = 5.0);
+    bool Send(uint32_t type, const vector<uint8_t> &payload);
+    // blocks until a whole message has arrived, false if the peer is gone
+    bool Receive(uint32_t &type, vector<uint8_t> &payload);
+    void Close();
+    bool IsOpen() const;
+    int GetFd() const;
+};
+
+#endif /* !_MESSAGECHANNEL_H_ */
@@ -0,0 +1,69 @@
+/* This file has been written and/or modified by the following people:
+ *
+ * Yang You
+ * Alex Schutz
+ *
+ */
+
+#ifndef _PLANNERCHECKPOINT_H_
+#define _PLANNERCHECKPOINT_H_
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+// Checkpoint file: a sequence of blocks, each
+//   uint32 magic | uint32 reserved | uint64 payload size | uint64 checksum | payload
+// appended and synced one at a time. A block cut short or damaged by a crash ends the
+// file for the reader; everything before it is kept. Payloads are in host byte order.
+const uint32_t CHECKPOINT_BLOCK_MAGIC = 0x4b504343; // "CCPK"
+
+// Appends blocks to a checkpoint file from a background thread. A block is handed over as
+// an encoder, run on that thread, so the caller only pays for copying what the block needs.
+class CheckpointWriter
+{
+private:
+    int fd = -1;
+    thread worker;
+    mutex queue_mutex;
+    condition_variable queue_cv;
+    condition_variable idle_cv;
+    deque<function<vector<uint8_t>()>> queue;
+    bool busy = false;
+    bool stopping = false;
+    bool failed = false;
+    unsigned long nb_blocks = 0;
+    unsigned long nb_bytes = 0;
+
+    void Run();
+
+public:
+    CheckpointWriter(){};
+    // writes the blocks still queued
+    ~CheckpointWriter();
+    CheckpointWriter(const CheckpointWriter &) = delete;
+    CheckpointWriter &operator=(const CheckpointWriter &) = delete;
+
+    // open filename for appending, creating it if needed
+    bool Open(const string &filename);
+    void Close();
+    // queue a block, encode returns its payload
+    void Append(function<vector<uint8_t>()> encode);
+    // wait until every queued block is on disk, false if a write failed
+    bool Flush();
+    bool HasFailed();
+    unsigned long GetNbBlocks();
+    unsigned long GetNbBytes();
+};
+
+// payloads of the valid blocks of filename, in order; false if it cannot be read
+bool ReadCheckpointBlocks(const string &filename, vector<vector<uint8_t>> &blocks);
+
+#endif /* !_PLANNERCHECKPOINT_H_ */
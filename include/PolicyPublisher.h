@@ -0,0 +1,99 @@
+/* This file has been written and/or modified by the following people:
+ *
+ * Yang You
+ * Alex Schutz
+ *
+ */
+
+#ifndef _POLICYPUBLISHER_H_
+#define _POLICYPUBLISHER_H_
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+#include "AlphaVectorFSC.h"
+#include "FscRuntime.h"
+
+using namespace std;
+
+// immutable controller published by the planner
+struct PolicySnapshot
+{
+    FscPolicyTable table;
+    // increases with every publication
+    uint64_t version = 0;
+    // value of the start node when the snapshot was taken
+    double start_value = 0.0;
+};
+
+// RCU-style publication of controller snapshots. The planner publishes a new immutable
+// snapshot whenever it likes, and readers pick up the newest one with two atomic
+// operations, never waiting for the planner or each other. Replaced snapshots are
+// freed by epoch-based reclamation once no reader that could still hold them is active.
+class PolicyPublisher
+{
+public:
+    static const int MAX_READERS = 256;
+
+private:
+    struct alignas(64) ReaderSlot
+    {
+        // epoch the reader entered in, 0 when outside a read section
+        atomic<uint64_t> epoch{0};
+        atomic<bool> in_use{false};
+    };
+
+    atomic<const PolicySnapshot *> current{nullptr};
+    atomic<uint64_t> global_epoch{1};
+    ReaderSlot readers[MAX_READERS];
+    // snapshots replaced at a given epoch, waiting for readers to move on
+    mutex retired_mutex;
+    vector<pair<const PolicySnapshot *, uint64_t>> retired;
+    uint64_t next_version = 1;
+
+public:
+    PolicyPublisher(){};
+    ~PolicyPublisher();
+    PolicyPublisher(const PolicyPublisher &) = delete;
+    PolicyPublisher &operator=(const PolicyPublisher &) = delete;
+
+    // publish a snapshot of fsc and reclaim what readers released, returns its version
+    uint64_t Publish(const AlphaVectorFSC &fsc);
+    // publish a prepared snapshot, the publisher takes ownership
+    uint64_t Publish(PolicySnapshot *snapshot);
+    // free the retired snapshots no reader can hold anymore, returns how many were freed
+    int Reclaim();
+    int GetNbRetired();
+
+    // each reading thread registers once, returns -1 if all slots are taken
+    int RegisterReader();
+    void UnregisterReader(int reader_id);
+    // the returned snapshot (nullptr before the first publication) stays valid until
+    // EndRead; read sections of one reader must not be nested
+    const PolicySnapshot *BeginRead(int reader_id);
+    void EndRead(int reader_id);
+};
+
+// scoped read section
+class PolicyReadGuard
+{
+private:
+    PolicyPublisher &publisher;
+    int reader_id;
+    const PolicySnapshot *snapshot;
+
+public:
+    PolicyReadGuard(PolicyPublisher &publisher, int reader_id)
+        : publisher(publisher), reader_id(reader_id), snapshot(publisher.BeginRead(reader_id))
+    {
+    }
+    ~PolicyReadGuard() { publisher.EndRead(reader_id); }
+    PolicyReadGuard(const PolicyReadGuard &) = delete;
+    PolicyReadGuard &operator=(const PolicyReadGuard &) = delete;
+
+    const PolicySnapshot *Get() const { return snapshot; }
+    const PolicySnapshot *operator->() const { return snapshot; }
+};
+
+#endif /* !_POLICYPUBLISHER_H_ */
@@ -0,0 +1,74 @@
+/* This file has been written and/or modified by the following people:
+ *
+ * Yang You
+ * Alex Schutz
+ *
+ */
+
+#ifndef _POMDPBOUNDS_H_
+#define _POMDPBOUNDS_H_
+
+#include <map>
+#include <vector>
+#include "BoundInterface.h"
+#include "PomdpInterface.h"
+#include "ThreadPool.h"
+
+using namespace std;
+
+// Value bounds of an explicit model, by value iteration over the states:
+//   upper: the MDP values V(s) = max_a Q(s,a), Q(s,a) = R(s,a) + gamma * sum T(s,a,s') V(s'),
+//          evaluated at a belief as QMDP, max_a sum_s b(s) Q(s,a), or as MDP, sum_s b(s) V(s)
+//   lower: the blind policies that repeat one action forever, max_a sum_s b(s) W_a(s)
+// The upper values start from Rmax / (1 - gamma) and the lower ones from Rmin / (1 - gamma),
+// so both sequences are monotone and remain valid bounds at any iteration. Sweeps are
+// Jacobi sweeps over CSR transition rows, with the states split among the threads, so the
+// result does not depend on the thread count.
+class PomdpBounds : public BoundInterface
+{
+private:
+    const PomdpInterface *pomdp;
+    int S_size;
+    int A_size;
+    double discount;
+    ThreadPool pool;
+
+    // CSR transition rows per (a, s), and rewards R[a * |S| + s]
+    vector<int> trans_start;
+    vector<int> trans_state;
+    vector<double> trans_prob;
+    vector<double> rewards;
+
+    // upper bound V(s), Q[a * |S| + s], and blind policy values W[a * |S| + s]
+    vector<double> V_upper;
+    vector<double> Q_upper;
+    vector<double> W_lower;
+    int last_iterations = 0;
+    double last_residual = 0.0;
+
+    void BuildSparseModel();
+    // one sweep of states [s_begin, s_end) from the previous values, returns the largest update
+    double Sweep(int s_begin, int s_end, const vector<double> &V_prev, const vector<double> &W_prev);
+
+public:
+    PomdpBounds(const PomdpInterface *pomdp, int nb_threads = 1);
+    ~PomdpBounds();
+
+    // iterate until the largest update of both bounds is below tolerance, returns the number of sweeps
+    int Compute(double tolerance = 1e-6, int max_iterations = 100000);
+
+    int GetLastIterations() const;
+    double GetLastResidual() const;
+    // QMDP upper bound, MDP upper bound and blind policy lower bound at a particle belief
+    double GetUpperBound(const vector<int> &particles) const;
+    double GetMDPUpperBound(const vector<int> &particles) const;
+    double GetLowerBound(const vector<int> &particles) const;
+    // the same at a sparse belief (e.g. GetInitBeliefSparse())
+    double GetUpperBound(const map<int, double> &belief) const;
+    double GetLowerBound(const map<int, double> &belief) const;
+    const vector<double> &GetMDPValues() const;
+    const vector<double> &GetQMDPValues() const;
+    const vector<double> &GetBlindValues() const;
+};
+
+#endif /* !_POMDPBOUNDS_H_ */
@@ -0,0 +1,50 @@
+/* This file has been written and/or modified by the following people:
+ *
+ * Yang You
+ * Alex Schutz
+ *
+ */
+
+#ifndef _POMDPSIMULATOR_H_
+#define _POMDPSIMULATOR_H_
+
+#include <map>
+#include <memory>
+#include <random>
+#include <vector>
+#include "PomdpInterface.h"
+#include "SimInterface.h"
+
+using namespace std;
+
+// Simulator sampling an explicit model (e.g. ParsedPOMDPSparse), so that it can be
+// planned with MCVI. The model is shared by all clones and must outlive them.
+class PomdpSimulator : public SimInterface
+{
+private:
+    const PomdpInterface *pomdp;
+    mt19937_64 rng;
+    double r_min, r_max;
+    // cumulative T(s, a, .) rows at (s * A + a) * S and O(a, s', .) rows at (s' * A + a) * O,
+    // built once for models without sparse distributions and shared by the clones
+    shared_ptr<const vector<double>> trans_cdf, obs_cdf;
+
+    int SampleFrom(const map<int, double> &dist);
+    int SampleFromCdf(const double *cdf, int size);
+
+public:
+    PomdpSimulator(const PomdpInterface *pomdp, unsigned long seed = 0);
+    ~PomdpSimulator();
+
+    tuple<int, int, double, bool> Step(int sI, int aI);
+    int SampleStartState();
+    int GetSizeOfObs() const;
+    int GetSizeOfA() const;
+    double GetDiscount() const;
+    int GetNbAgent() const;
+    SimInterface *Clone() const;
+    void SetSeed(unsigned long seed);
+    bool GetRewardBounds(double &r_min, double &r_max) const;
+};
+
+#endif /* !_POMDPSIMULATOR_H_ */
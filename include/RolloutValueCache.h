@@ -0,0 +1,73 @@
+/* This file has been written and/or modified by the following people:
+ *
+ * Yang You
+ * Alex Schutz
+ *
+ */
+
+#ifndef _ROLLOUTVALUECACHE_H_
+#define _ROLLOUTVALUECACHE_H_
+
+#include <atomic>
+#include <memory>
+#include <vector>
+#include "RunningStat.h"
+
+using namespace std;
+
+// Running estimates of the rollout value of (node, state) pairs, shared by all workers of
+// a backup. The table is a fixed size open addressing table: slots are claimed with a
+// compare-and-swap on the key and each entry is updated under its own spin lock. When the
+// probe sequence is exhausted the pair is simply not cached.
+// An entry is only valid while its node keeps its successors: InvalidateNode() bumps the
+// epoch of a node, which lazily resets its entries. InvalidateNode(), Clear() and
+// Renumber() must not run concurrently with Lookup() or Add().
+class RolloutValueCache
+{
+private:
+    struct Entry
+    {
+        // 0 marks a free slot, otherwise ((nI + 1) << 32) | sI
+        atomic<unsigned long long> key{0};
+        atomic<bool> locked{false};
+        unsigned epoch = 0;
+        RunningStat stat;
+    };
+
+    unique_ptr<Entry[]> entries;
+    size_t capacity;
+    vector<unsigned> node_epoch;
+    atomic<size_t> nb_entries{0};
+
+    static unsigned long long MakeKey(int nI, int sI);
+    unsigned GetEpoch(int nI) const;
+    // entry of the key, claimed if absent; nullptr if the table has no room left
+    Entry *FindOrAdd(unsigned long long key);
+    // entry of the key, nullptr if absent; never claims a slot
+    Entry *Find(unsigned long long key) const;
+    void Lock(Entry &e);
+    void Unlock(Entry &e);
+
+public:
+    // capacity is rounded up to a power of two
+    explicit RolloutValueCache(size_t capacity);
+    ~RolloutValueCache();
+
+    // copy the estimate of (nI, sI) into stat; false, with stat reset, if the pair has
+    // no entry (nothing added yet, or no room for it)
+    bool Lookup(int nI, int sI, RunningStat &stat);
+    // add one rollout value of (nI, sI)
+    void Add(int nI, int sI, double value);
+
+    // forget the estimates of node nI
+    void InvalidateNode(int nI);
+    void Clear();
+    // move the estimates of node k to new_index[k], drop them if -1; when several nodes map
+    // to the same index the estimate with most samples is kept
+    void Renumber(const vector<int> &new_index);
+
+    size_t GetNbEntries() const;
+    size_t GetCapacity() const;
+};
+
+#endif /* !_ROLLOUTVALUECACHE_H_ */
@@ -0,0 +1,42 @@
+/* This file has been written and/or modified by the following people:
+ *
+ * Yang You
+ * Alex Schutz
+ *
+ */
+
+#ifndef _RUNNINGSTAT_H_
+#define _RUNNINGSTAT_H_
+
+// Running mean and variance of a stream of samples (Welford's update), numerically
+// stable when the variance is small relative to the mean.
+struct RunningStat
+{
+    unsigned long count = 0;
+    double mean = 0.0;
+    // sum of squared deviations from the mean
+    double m2 = 0.0;
+
+    void Add(double x)
+    {
+        count++;
+        double delta = x - mean;
+        mean += delta / count;
+        m2 += delta * (x - mean);
+    }
+
+    // unbiased sample variance, 0 with fewer than two samples
+    double GetVariance() const
+    {
+        return count > 1 ? m2 / (count - 1) : 0.0;
+    }
+
+    void Reset()
+    {
+        count = 0;
+        mean = 0.0;
+        m2 = 0.0;
+    }
+};
+
+#endif /* !_RUNNINGSTAT_H_ */
@@ -0,0 +1,86 @@
+/* This file has been written and/or modified by the following people:
+ *
+ * Yang You
+ * Alex Schutz
+ *
+ */
+
+#ifndef _SAMPLEDBOUNDS_H_
+#define _SAMPLEDBOUNDS_H_
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include "BoundInterface.h"
+#include "SimInterface.h"
+#include "ThreadPool.h"
+
+using namespace std;
+
+// Bounds for problems only given as a simulator. The reachable states are explored
+// breadth first from start states; every (s, a) is sampled nb_samples times, which
+// gives an empirical model (successor frequencies, mean reward, terminal transitions).
+// Value iteration on that model gives the fully observable MDP values as an upper bound
+// and the blind policy values as a lower bound; a belief gets the particle average
+// (QMDP style for the upper bound). States beyond the explored set keep the optimistic
+// value Rmax / (1 - gamma) in the upper bound and Rmin / (1 - gamma) in the lower one,
+// with the reward bounds declared by the simulator or else the observed ones.
+// The bounds are estimates: they only hold up to the sampling error of the model.
+class SampledBounds : public BoundInterface
+{
+private:
+    SimInterface *sim;
+    int A_size;
+    double discount;
+    unsigned long seed;
+    ThreadPool pool;
+    vector<SimInterface *> worker_sims;
+    vector<unique_ptr<SimInterface>> owned_sims;
+
+    // explored states: simulator state of each index, and the index of each state
+    vector<int> states;
+    unordered_map<int, int> state_index;
+    int nb_expanded = 0;
+    // CSR rows per (i, a) of the expanded states: successor indices (-1 = terminal) and
+    // frequencies; mean rewards R[i * |A| + a]
+    vector<int> row_start;
+    vector<int> succ_index;
+    vector<double> succ_prob;
+    vector<double> rewards;
+    bool has_reward_bounds = false;
+    double r_min = 0.0, r_max = 0.0;
+
+    // V(i), Q[i * |A| + a] and blind values W[i * |A| + a]
+    vector<double> V_upper;
+    vector<double> Q_upper;
+    vector<double> W_lower;
+    int last_iterations = 0;
+    double last_residual = 0.0;
+
+    int AddState(int sI);
+    double Sweep(int i_begin, int i_end, const vector<double> &V_prev, const vector<double> &W_prev);
+    double GetOptimisticValue() const;
+    double GetPessimisticValue() const;
+
+public:
+    SampledBounds(SimInterface *sim, int nb_threads = 1, unsigned long seed = 0);
+    ~SampledBounds();
+
+    // expand the states reachable from start_states, at most max_states in total;
+    // returns the number of expanded states
+    int Explore(const vector<int> &start_states, int nb_samples = 20, int max_states = 100000);
+    // value iteration on the sampled model, returns the number of sweeps
+    int Compute(double tolerance = 1e-6, int max_iterations = 100000);
+
+    int GetNbStates() const;
+    int GetNbExpanded() const;
+    int GetLastIterations() const;
+    double GetLastResidual() const;
+    // bounds of a single state
+    double GetUpperBound(int sI) const;
+    double GetLowerBound(int sI) const;
+    double GetUpperBound(const vector<int> &particles) const;
+    double GetLowerBound(const vector<int> &particles) const;
+};
+
+#endif /* !_SAMPLEDBOUNDS_H_ */
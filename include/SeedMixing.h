@@ -0,0 +1,20 @@
+/* This file has been written and/or modified by the following people:
+ *
+ * Yang You
+ * Alex Schutz
+ *
+ */
+
+#ifndef _SEEDMIXING_H_
+#define _SEEDMIXING_H_
+
+// splitmix64 mixing, used to derive independent seeds from a seed and an index
+inline unsigned long MixSeed(unsigned long x)
+{
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+#endif /* !_SEEDMIXING_H_ */
@@ -16,6 +16,7 @@
 #include <sstream>
 #include <map>
 #include <cmath>
+#include <tuple>
 using namespace std;
 
 class SimInterface
@@ -35,6 +36,28 @@ public:
     virtual int GetNbAgent() const = 0;
     // --------------------------------------------------------
 
+    // ------- optional functions for parallel planning ----------
+    // independent copy with its own random engine, used by one worker thread;
+    // simulators returning nullptr are only used sequentially
+    virtual SimInterface *Clone() const
+    {
+        return nullptr;
+    };
+    // re-seed the random engine so that a sample can be reproduced
+    virtual void SetSeed(unsigned long seed)
+    {
+        (void)(seed);
+    };
+    // bounds of the immediate reward, used to cut rollouts once the remaining discounted
+    // reward is negligible; returns false if unknown
+    virtual bool GetRewardBounds(double &r_min, double &r_max) const
+    {
+        (void)(r_min);
+        (void)(r_max);
+        return false;
+    };
+    // --------------------------------------------------------
+
     // Maybe add visulization functions? :)
 
 };
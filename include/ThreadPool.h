@@ -0,0 +1,50 @@
+/* This file has been written and/or modified by the following people:
+ *
+ * Yang You
+ * Alex Schutz
+ *
+ */
+
+#ifndef _THREADPOOL_H_
+#define _THREADPOOL_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+// Fixed set of worker threads running indexed tasks. The calling thread takes part as
+// worker 0, so a pool of one thread runs everything inline.
+class ThreadPool
+{
+private:
+    vector<thread> workers;
+    mutex m;
+    condition_variable cv_work;
+    condition_variable cv_done;
+    const function<void(int, int)> *job = nullptr;
+    int nb_tasks = 0;
+    atomic<int> next_task{0};
+    int nb_busy = 0;
+    unsigned long generation = 0;
+    bool stop = false;
+
+    void RunTasks(const function<void(int, int)> *fn, int count, int worker);
+    void WorkerLoop(int worker);
+
+public:
+    explicit ThreadPool(int nb_threads);
+    ~ThreadPool();
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    int GetNbThreads() const;
+    // run fn(task, worker) for every task in [0, nb_tasks) and wait for all of them
+    void ParallelFor(int nb_tasks, const function<void(int task, int worker)> &fn);
+};
+
+#endif /* !_THREADPOOL_H_ */
@@ -0,0 +1,92 @@
+/* This file has been written and/or modified by the following people:
+ *
+ * Yang You
+ * Alex Schutz
+ *
+ */
+
+#ifndef _TRAJECTORYSTORE_H_
+#define _TRAJECTORYSTORE_H_
+
+#include <memory>
+#include <vector>
+
+using namespace std;
+
+// one step of a rollout: in node nI the action aI led to observation oI, state s_nextI
+// and reward r
+struct StoredStep
+{
+    int nI;
+    int aI;
+    int oI;
+    int s_nextI;
+    double r;
+};
+
+struct StoredTrajectory
+{
+    vector<StoredStep> steps;
+    // the last step reached a terminal state
+    bool done = false;
+};
+
+// a backup sample: the first step from the belief and the rollout of every node after it
+struct StoredSample
+{
+    bool valid = false;
+    int sI = 0;
+    int s_newI = 0;
+    int oI = 0;
+    double r = 0.0;
+    bool done = false;
+    // backups that replayed the sample since it was drawn
+    int nb_reuses = 0;
+    vector<StoredTrajectory> trajectories;
+};
+
+// Backup samples kept across iterations, so that a later backup of the same belief can
+// replay them against the updated controller instead of simulating from scratch. The
+// samples of the most recently used beliefs are kept, each as A * nb_sample slots, as
+// long as they fit in max_bytes; Trim() evicts the least recently used ones past it.
+class TrajectoryStore
+{
+private:
+    struct BeliefSamples
+    {
+        unsigned long long key;
+        unsigned long last_use;
+        int A, K;
+        vector<StoredSample> samples;
+    };
+
+    vector<unique_ptr<BeliefSamples>> beliefs;
+    int max_beliefs;
+    size_t max_bytes;
+    unsigned long clock = 0;
+
+    static size_t GetNbBytes(const BeliefSamples &b);
+    void EvictOldest();
+
+public:
+    // max_bytes of 0 means no memory bound
+    TrajectoryStore(int max_beliefs, size_t max_bytes = 0);
+    ~TrajectoryStore();
+
+    // key identifying a particle belief
+    static unsigned long long HashBelief(const vector<int> &belief);
+    // slots [aI * K + i] of the belief, created empty (and the least recently used belief
+    // evicted) if absent or of another shape
+    StoredSample *GetSamples(unsigned long long key, int A, int K);
+    // follow a renumbering of the controller, see AlphaVectorFSC::Renumber
+    void Renumber(const vector<int> &new_index);
+    // evict beliefs, least recently used first, until the samples fit in max_bytes; the
+    // pointers returned by GetSamples for evicted beliefs become invalid
+    void Trim();
+    void Clear();
+    int GetNbBeliefs() const;
+    // memory held by the samples, trajectory steps included
+    size_t GetNbBytes() const;
+};
+
+#endif /* !_TRAJECTORYSTORE_H_ */
@@ -0,0 +1,125 @@
+/* This file has been written and/or modified by the following people:
+ *
+ * Yang You
+ * Alex Schutz
+ *
+ */
+
+#ifndef _WORKSTEALINGSCHEDULER_H_
+#define _WORKSTEALINGSCHEDULER_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+class WorkStealingScheduler;
+
+// Tasks forked together and waited for together.
+class TaskGroup
+{
+private:
+    friend class WorkStealingScheduler;
+    WorkStealingScheduler &scheduler;
+    atomic<int> pending{0};
+
+public:
+    explicit TaskGroup(WorkStealingScheduler &scheduler);
+    ~TaskGroup();
+    TaskGroup(const TaskGroup &) = delete;
+    TaskGroup &operator=(const TaskGroup &) = delete;
+
+    // queue fn(worker) on the deque of the calling worker
+    void Fork(function<void(int worker)> fn);
+    // run queued tasks until every task of the group has finished
+    void Join();
+};
+
+// Load balance of the ParallelFor calls since the last ResetStats(). The busy time of
+// a worker is the time it spent in task bodies; the imbalance is the sum over the calls
+// of the largest busy time over the sum of the mean busy time, 1 when perfectly balanced.
+struct SchedulerStats
+{
+    unsigned long nb_parallel_fors = 0;
+    unsigned long nb_tasks = 0;
+    unsigned long nb_steals = 0;
+    double busy_max = 0.0;
+    double busy_mean = 0.0;
+
+    double GetLoadImbalance() const { return this->busy_mean > 0.0 ? this->busy_max / this->busy_mean : 1.0; }
+};
+
+// Fixed set of worker threads, each with its own deque of tasks. A worker runs the newest
+// task of its own deque and, when it is empty, steals the oldest task of another worker.
+// The calling thread takes part as worker 0, so a scheduler of one thread runs everything
+// inline; only one thread outside the scheduler may use it at a time. A task may fork and
+// join further tasks; while it waits in Join its worker runs other tasks, so state kept
+// per worker must not be in use across a Join. Those are any queued tasks, not only the
+// group's: an outer task waiting for its inner tasks can run a whole other outer task
+// first, and only returns once that one is done. Each outer task runs once, so the stack
+// of a worker holds at most as many nested outer tasks as were forked. Without stealing
+// every worker only runs its own deque, which is the static partition of the tasks.
+class WorkStealingScheduler
+{
+private:
+    friend class TaskGroup;
+    struct Task
+    {
+        function<void(int)> fn;
+        TaskGroup *group;
+    };
+    struct WorkerQueue
+    {
+        mutex m;
+        deque<Task *> tasks;
+        atomic<int> size{0};
+        atomic<unsigned long> nb_tasks{0};
+        atomic<unsigned long> nb_steals{0};
+    };
+
+    vector<thread> workers;
+    vector<unique_ptr<WorkerQueue>> queues;
+    atomic<bool> stealing{true};
+    atomic<int> nb_queued{0};
+    mutex m;
+    condition_variable cv;
+    bool stop = false;
+
+    mutable mutex stats_mutex;
+    unsigned long nb_parallel_fors = 0;
+    double busy_max = 0.0;
+    double busy_mean = 0.0;
+
+    int GetCurrentWorker() const;
+    void Push(int worker, Task *task);
+    void Notify();
+    Task *TakeTask(int worker);
+    void Execute(Task *task, int worker);
+    bool HasWork(int worker) const;
+    void Join(TaskGroup &group);
+    void WorkerLoop(int worker);
+
+public:
+    explicit WorkStealingScheduler(int nb_threads);
+    ~WorkStealingScheduler();
+    WorkStealingScheduler(const WorkStealingScheduler &) = delete;
+    WorkStealingScheduler &operator=(const WorkStealingScheduler &) = delete;
+
+    int GetNbThreads() const;
+    void SetStealing(bool stealing);
+    bool GetStealing() const;
+    // Run fn(task, worker) for every task in [0, nb_tasks) and wait for all of them. The
+    // tasks are dealt to the workers in contiguous blocks, the first block to the caller.
+    void ParallelFor(int nb_tasks, const function<void(int task, int worker)> &fn);
+
+    SchedulerStats GetStats() const;
+    void ResetStats();
+};
+
+#endif /* !_WORKSTEALINGSCHEDULER_H_ */
@@ -1,96 +1,220 @@
-    #include<iostream>
-    #include<vector>
-    #include<random>
-    
-    using namespace std;
-    
-    // Define the struct for FSC node
-    struct FscNode{
-        // particles of the node's state
-        vector<double>_state_particles;
-        
-        // dictionary for Q-action
-        Dict<Any, double>_Q_action;
-        
-        // dictionary for reward action
-        Dict<Any, double>_R_action;
-        
-        // dictionary for value of action-observation
-        Dict<Any, Dict<Int64, double>>_V_a_o_n;
-        
-        // value of the node
-        double _V_node;
-    };
-    
-    // Define the struct for FSC
-    struct FSC{
-        // vector of pairs for eta
-        vector<Dict<Pair<Any, Int64>, Int64>>_eta;
-        
-        // vector of nodes
-        vector<FscNode>_nodes;
-        
-        // action space
-        Dict<Int64, Int64>_action_space;
-    };
-    
-    // Function to initialize FSC node
-    function InitFscNode(action_space, obs_space){
-        // initialize particles, Q-action, reward action, value of action-observation, and value of the node
-        vector<double> init_particles;
-        Dict<Any, double> init_Q_action = Dict<Any, double>();
-        Dict<Any, double> init_R_action = Dict<Any, double>();
-        Dict<Any, Dict<Int64, double>> init_V_a_o_n = Dict<Any, Dict<Int64, double>>();
-        for (int a =0; a< action_space.size(); a++){
-            init_Q_action[a]=0.0;
-            init_R_action[a]=0.0;
-            init_V_a_o_n[a]= Dict<Int64, double>();
-            for (int o =0; o< obs_space.size(); o++){
-                init_V_a_o_n[a][o]=  Dict<Int64, double>();
-            }
+#include "../include/AlphaVectorFSC.h"
+
+#include <algorithm>
+#include <cmath>
+
+/* initialize an empty FSC over the given action and observation spaces */
+AlphaVectorFSC::AlphaVectorFSC(int A_size, int Obs_size, double max_accept_belief_gap)
+    : A_size(A_size), Obs_size(Obs_size), max_accept_belief_gap(max_accept_belief_gap)
+{
+}
+
+AlphaVectorFSC::~AlphaVectorFSC()
+{
+}
+
+/* initialize Q-action, reward action and node value, and keep the belief particles */
+FscNode AlphaVectorFSC::CreateNode(const vector<int> &b) const
+{
+    FscNode node;
+    node.state_particles = b;
+    node.Q_action.assign(this->A_size, 0.0);
+    node.R_action.assign(this->A_size, 0.0);
+    node.V_node = 0.0;
+    node.best_action = -1;
+    return node;
+}
+
+int AlphaVectorFSC::AddNode(const FscNode &node)
+{
+    this->nodes.push_back(node);
+    this->eta.resize(this->nodes.size() * this->A_size * this->Obs_size, -1);
+    return this->nodes.size() - 1;
+}
+
+int AlphaVectorFSC::GetNodeSize() const
+{
+    return this->nodes.size();
+}
+
+int AlphaVectorFSC::GetSizeOfA() const
+{
+    return this->A_size;
+}
+
+int AlphaVectorFSC::GetSizeOfObs() const
+{
+    return this->Obs_size;
+}
+
+double AlphaVectorFSC::GetMaxAcceptBeliefGap() const
+{
+    return this->max_accept_belief_gap;
+}
+
+FscNode &AlphaVectorFSC::GetNode(int nI)
+{
+    return this->nodes[nI];
+}
+
+const FscNode &AlphaVectorFSC::GetNode(int nI) const
+{
+    return this->nodes[nI];
+}
+
+int AlphaVectorFSC::GetBestAction(int nI) const
+{
+    return this->nodes[nI].best_action;
+}
+
+int AlphaVectorFSC::GetEtaValue(int nI, int aI, int oI) const
+{
+    return this->eta[((size_t)nI * this->A_size + aI) * this->Obs_size + oI];
+}
+
+void AlphaVectorFSC::UpdateEta(int nI, int aI, int oI, int nI_next)
+{
+    this->eta[((size_t)nI * this->A_size + aI) * this->Obs_size + oI] = nI_next;
+}
+
+const vector<int> &AlphaVectorFSC::GetEta() const
+{
+    return this->eta;
+}
+
+void AlphaVectorFSC::Renumber(const vector<int> &new_index)
+{
+    int new_size = 0;
+    for (int ni : new_index)
+        new_size = max(new_size, ni + 1);
+
+    const size_t row = (size_t)this->A_size * this->Obs_size;
+    vector<FscNode> new_nodes(new_size);
+    vector<int> new_eta((size_t)new_size * row, -1);
+    vector<bool> assigned(new_size, false);
+    for (int nI = 0; nI < (int)this->nodes.size(); nI++)
+    {
+        int ni = new_index[nI];
+        if (ni < 0 || assigned[ni])
+            continue;
+        assigned[ni] = true;
+        new_nodes[ni] = std::move(this->nodes[nI]);
+        for (size_t e = 0; e < row; e++)
+        {
+            int target = this->eta[nI * row + e];
+            new_eta[ni * row + e] = target < 0 ? -1 : new_index[target];
         }
-        
-        // return the FSC node with the initial values
-        return FscNode(init_particles,
-                        init_Q_action,
-                        init_R_action,
-                        init_V_a_o_n,
-                        init_V_node);
     }
-    
-    // Function to create node
-    function CreatNode(b, action_space){
-        // initialize FSC node with the given action space
-        FscNode node = InitFscNode(action_space);
-        node._state_particles = b;
-        return node;
+    this->nodes.swap(new_nodes);
+    this->eta.swap(new_eta);
+}
+
+void AlphaVectorFSC::SetMaxNodeSize(int max_node_size)
+{
+    // the start node is never replaced, so a budget of 1 leaves nothing to give up
+    if (max_node_size == 1)
+    {
+        cerr << "node budget of 1 is too small, using 2" << endl;
+        max_node_size = 2;
     }
-    
-    // Function to initialize FSC with given parameters
-    function InitFSC(max_accept_belief_gap::Float64, max_node_size::Int64, action_space){
-        // initialize eta vector with given max node size
-        vector<Dict<Pair<Any, Int64>, Int64>> init_eta(max_node_size);
-        for (int i =1; i<= max_node_size; i++){
-            init_eta[i-1]= Dict<Pair<Any, Int64>, Int64>();
+    this->max_node_size = max(max_node_size, 0);
+}
+
+int AlphaVectorFSC::GetMaxNodeSize() const
+{
+    return this->max_node_size;
+}
+
+bool AlphaVectorFSC::IsFull() const
+{
+    return this->max_node_size > 0 && (int)this->nodes.size() >= this->max_node_size;
+}
+
+int AlphaVectorFSC::FindReplaceableNode(FscReplacementPolicy policy) const
+{
+    int victim = -1;
+    for (int nI = 1; nI < (int)this->nodes.size(); nI++)
+    {
+        if (victim < 0)
+        {
+            victim = nI;
+            continue;
         }
-        
-        // return the FSC with the initial eta and nodes
-        return FSC(init_eta,
-                    init_nodes,
-                    action_space);
+        const FscNode &n = this->nodes[nI];
+        const FscNode &v = this->nodes[victim];
+        bool better;
+        if (policy == FscReplacementPolicy::LeastVisited)
+            better = n.nb_visits < v.nb_visits || (n.nb_visits == v.nb_visits && n.V_node < v.V_node);
+        else
+            better = n.V_node < v.V_node || (n.V_node == v.V_node && n.nb_visits < v.nb_visits);
+        if (better)
+            victim = nI;
     }
-    
-    // Function to get the best action
-    function GetBestAction(n::FscNode){
-        // get the maximum Q-value
-        double Q_max = typemin<double>();
-        int best_a = rand(n._Q_action.keys())
-        for (int a =0; a< n._Q_action.size(); a++){
-            if (n._Q_action[a]> Q_max&& n._visits_action[a]!=0){
-                Q_max = n._Q_action[a];
-                best_a = a;
-            }
+    return victim;
+}
+
+int AlphaVectorFSC::FindSubstituteNode(int nI) const
+{
+    const FscNode &target = this->nodes[nI];
+    int best = -1;
+    bool best_same_action = false;
+    double best_gap = 0.0;
+    for (int k = 0; k < (int)this->nodes.size(); k++)
+    {
+        if (k == nI)
+            continue;
+        bool same_action = this->nodes[k].best_action == target.best_action;
+        double gap = fabs(this->nodes[k].V_node - target.V_node);
+        if (best < 0 || (same_action && !best_same_action) || (same_action == best_same_action && gap < best_gap))
+        {
+            best = k;
+            best_same_action = same_action;
+            best_gap = gap;
         }
-    
-        return best_a;
-    }
\ No newline at end of file
+    }
+    return best;
+}
+
+int AlphaVectorFSC::ReplaceNode(int nI, const FscNode &node, const vector<int> &edges)
+{
+    const size_t row = (size_t)this->A_size * this->Obs_size;
+    int substitute = this->FindSubstituteNode(nI);
+    for (int &target : this->eta)
+        if (target == nI)
+            target = substitute;
+
+    this->nodes[nI] = node;
+    for (size_t e = 0; e < row; e++)
+        this->eta[nI * row + e] = edges[e] == nI ? substitute : edges[e];
+    return substitute;
+}
+
+int AlphaVectorFSC::AddNodeBounded(const FscNode &node, const vector<int> &edges, FscReplacementPolicy policy)
+{
+    if (this->IsFull())
+    {
+        int victim = this->FindReplaceableNode(policy);
+        if (victim < 0)
+            return -1;
+        this->ReplaceNode(victim, node, edges);
+        return victim;
+    }
+
+    int nI = this->AddNode(node);
+    const size_t row = (size_t)this->A_size * this->Obs_size;
+    copy(edges.begin(), edges.end(), this->eta.begin() + nI * row);
+    return nI;
+}
+
+int ComputeBestAction(const FscNode &n)
+{
+    int best_a = -1;
+    for (int a = 0; a < (int)n.Q_action.size(); a++)
+    {
+        if (best_a < 0 || n.Q_action[a] > n.Q_action[best_a])
+        {
+            best_a = a;
+        }
+    }
+    return best_a;
+}
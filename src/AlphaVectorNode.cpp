@@ -0,0 +1,105 @@
+#include "../include/AlphaVectorNode.h"
+
+#include <algorithm>
+
+AlphaVectorNode::AlphaVectorNode(int nI, const vector<double> &dense_values)
+    : nI(nI), S_size(dense_values.size()), values(dense_values)
+{
+}
+
+AlphaVectorNode::AlphaVectorNode(int nI, int S_size, const map<int, double> &sparse_values, double default_value)
+    : nI(nI), S_size(S_size), default_value(default_value), is_sparse(true)
+{
+    // map keys are already sorted
+    for (const auto &it : sparse_values)
+    {
+        this->sparse_index.push_back(it.first);
+        this->values.push_back(it.second);
+    }
+}
+
+AlphaVectorNode::~AlphaVectorNode()
+{
+}
+
+int AlphaVectorNode::GetNodeIndex() const
+{
+    return this->nI;
+}
+
+int AlphaVectorNode::GetSizeOfS() const
+{
+    return this->S_size;
+}
+
+bool AlphaVectorNode::IsSparse() const
+{
+    return this->is_sparse;
+}
+
+double AlphaVectorNode::operator[](int sI) const
+{
+    if (!this->is_sparse)
+        return this->values[sI];
+    auto it = lower_bound(this->sparse_index.begin(), this->sparse_index.end(), sI);
+    if (it == this->sparse_index.end() || *it != sI)
+        return this->default_value;
+    return this->values[it - this->sparse_index.begin()];
+}
+
+double AlphaVectorNode::Dot(const vector<double> &belief) const
+{
+    double v = 0.0;
+    if (!this->is_sparse)
+    {
+        for (int sI = 0; sI < this->S_size; sI++)
+            v += this->values[sI] * belief[sI];
+        return v;
+    }
+    // default_value * sum(b) plus the stored corrections
+    double mass = 0.0;
+    for (int sI = 0; sI < this->S_size; sI++)
+        mass += belief[sI];
+    v = this->default_value * mass;
+    for (size_t k = 0; k < this->sparse_index.size(); k++)
+        v += (this->values[k] - this->default_value) * belief[this->sparse_index[k]];
+    return v;
+}
+
+double AlphaVectorNode::Dot(const map<int, double> &belief) const
+{
+    double v = 0.0;
+    for (const auto &it : belief)
+        v += it.second * (*this)[it.first];
+    return v;
+}
+
+double AlphaVectorNode::Dot(const vector<int> &particles) const
+{
+    if (particles.empty())
+        return 0.0;
+    double v = 0.0;
+    for (int sI : particles)
+        v += (*this)[sI];
+    return v / particles.size();
+}
+
+bool AlphaVectorNode::Dominates(const AlphaVectorNode &o) const
+{
+    for (int sI = 0; sI < this->S_size; sI++)
+        if ((*this)[sI] < o[sI])
+            return false;
+    return true;
+}
+
+void AlphaVectorNode::CopyDense(double *out) const
+{
+    if (!this->is_sparse)
+    {
+        copy(this->values.begin(), this->values.end(), out);
+        return;
+    }
+    fill(out, out + this->S_size, this->default_value);
+    for (size_t k = 0; k < this->sparse_index.size(); k++)
+        out[this->sparse_index[k]] = this->values[k];
+}
@@ -0,0 +1,252 @@
+#include "../include/AlphaVectorSet.h"
+
+#include <algorithm>
+#include <limits>
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+// rows sharing each belief load
+static const int ROW_GROUP = 4;
+// rows whose partial sums are kept while streaming over the states
+static const int ROW_TILE = 64;
+// belief entries per pass (16 KB), reused from L1 across the rows of a tile
+static const int STATE_BLOCK = 2048;
+
+/* acc[k] += row_k[s0 .. s1) . b[s0 .. s1), with s0 and s1 multiples of 8 */
+static inline void DotGroup(const double *const *rows, int nb_rows, const double *b, int s0, int s1, double *acc)
+{
+#if defined(__AVX512F__)
+    __m512d sum[ROW_GROUP];
+    for (int k = 0; k < nb_rows; k++)
+        sum[k] = _mm512_setzero_pd();
+    for (int s = s0; s < s1; s += 8)
+    {
+        __m512d bv = _mm512_loadu_pd(b + s);
+        for (int k = 0; k < nb_rows; k++)
+            sum[k] = _mm512_fmadd_pd(_mm512_loadu_pd(rows[k] + s), bv, sum[k]);
+    }
+    for (int k = 0; k < nb_rows; k++)
+    {
+        double lanes[8];
+        _mm512_storeu_pd(lanes, sum[k]);
+        acc[k] += ((lanes[0] + lanes[1]) + (lanes[2] + lanes[3])) + ((lanes[4] + lanes[5]) + (lanes[6] + lanes[7]));
+    }
+#elif defined(__AVX2__) && defined(__FMA__)
+    __m256d sum[ROW_GROUP];
+    for (int k = 0; k < nb_rows; k++)
+        sum[k] = _mm256_setzero_pd();
+    for (int s = s0; s < s1; s += 4)
+    {
+        __m256d bv = _mm256_loadu_pd(b + s);
+        for (int k = 0; k < nb_rows; k++)
+            sum[k] = _mm256_fmadd_pd(_mm256_loadu_pd(rows[k] + s), bv, sum[k]);
+    }
+    for (int k = 0; k < nb_rows; k++)
+    {
+        __m128d half = _mm_add_pd(_mm256_castpd256_pd128(sum[k]), _mm256_extractf128_pd(sum[k], 1));
+        acc[k] += _mm_cvtsd_f64(_mm_add_sd(half, _mm_unpackhi_pd(half, half)));
+    }
+#else
+    for (int k = 0; k < nb_rows; k++)
+    {
+        double v = 0.0;
+        for (int s = s0; s < s1; s++)
+            v += rows[k][s] * b[s];
+        acc[k] += v;
+    }
+#endif
+}
+
+AlphaVectorSet::AlphaVectorSet(int S_size)
+    : S_size(S_size), row_stride((S_size + 7) / 8 * 8)
+{
+}
+
+AlphaVectorSet::AlphaVectorSet(int nb_nodes, int S_size, const vector<double> &node_major_values)
+    : AlphaVectorSet(S_size)
+{
+    for (int nI = 0; nI < nb_nodes; nI++)
+        this->AddVector(nI, &node_major_values[(size_t)nI * S_size]);
+}
+
+AlphaVectorSet::~AlphaVectorSet()
+{
+}
+
+void AlphaVectorSet::AddVector(const AlphaVectorNode &alpha)
+{
+    this->matrix.resize(this->matrix.size() + this->row_stride, 0.0);
+    alpha.CopyDense(&this->matrix[this->matrix.size() - this->row_stride]);
+    this->node_index.push_back(alpha.GetNodeIndex());
+}
+
+void AlphaVectorSet::AddVector(int nI, const double *values)
+{
+    this->matrix.resize(this->matrix.size() + this->row_stride, 0.0);
+    copy(values, values + this->S_size, &this->matrix[this->matrix.size() - this->row_stride]);
+    this->node_index.push_back(nI);
+}
+
+int AlphaVectorSet::GetSize() const
+{
+    return this->node_index.size();
+}
+
+int AlphaVectorSet::GetSizeOfS() const
+{
+    return this->S_size;
+}
+
+int AlphaVectorSet::GetNodeIndex(int row) const
+{
+    return this->node_index[row];
+}
+
+const double *AlphaVectorSet::GetRow(int row) const
+{
+    return &this->matrix[(size_t)row * this->row_stride];
+}
+
+int AlphaVectorSet::BestNode(const vector<double> &belief, double *value) const
+{
+    const int N = this->GetSize();
+    // zero padded copy so that the tail of every row contributes nothing
+    vector<double> b(this->row_stride, 0.0);
+    copy(belief.begin(), belief.begin() + min((int)belief.size(), this->S_size), b.begin());
+
+    int best_row = -1;
+    double best_value = -numeric_limits<double>::infinity();
+    double acc[ROW_TILE];
+    for (int t0 = 0; t0 < N; t0 += ROW_TILE)
+    {
+        const int t1 = min(N, t0 + ROW_TILE);
+        fill(acc, acc + ROW_TILE, 0.0);
+        for (int s0 = 0; s0 < this->row_stride; s0 += STATE_BLOCK)
+        {
+            const int s1 = min(this->row_stride, s0 + STATE_BLOCK);
+            for (int r = t0; r < t1; r += ROW_GROUP)
+            {
+                const int nb_rows = min(ROW_GROUP, t1 - r);
+                const double *rows[ROW_GROUP];
+                for (int k = 0; k < nb_rows; k++)
+                    rows[k] = this->GetRow(r + k);
+                DotGroup(rows, nb_rows, b.data(), s0, s1, &acc[r - t0]);
+            }
+        }
+        for (int r = t0; r < t1; r++)
+        {
+            if (acc[r - t0] > best_value)
+            {
+                best_value = acc[r - t0];
+                best_row = r;
+            }
+        }
+    }
+
+    if (value)
+        *value = best_value;
+    return best_row < 0 ? -1 : this->node_index[best_row];
+}
+
+int AlphaVectorSet::BestNode(const map<int, double> &belief, double *value) const
+{
+    // few states in the support: gather them once and scan the rows
+    vector<int> support;
+    vector<double> weights;
+    for (const auto &it : belief)
+    {
+        support.push_back(it.first);
+        weights.push_back(it.second);
+    }
+
+    int best_row = -1;
+    double best_value = -numeric_limits<double>::infinity();
+    for (int r = 0; r < this->GetSize(); r++)
+    {
+        const double *row = this->GetRow(r);
+        double v = 0.0;
+        for (size_t k = 0; k < support.size(); k++)
+            v += weights[k] * row[support[k]];
+        if (v > best_value)
+        {
+            best_value = v;
+            best_row = r;
+        }
+    }
+
+    if (value)
+        *value = best_value;
+    return best_row < 0 ? -1 : this->node_index[best_row];
+}
+
+int AlphaVectorSet::BestNode(const vector<int> &particles, double *value) const
+{
+    map<int, double> belief;
+    for (int sI : particles)
+        belief[sI] += 1.0 / particles.size();
+    return this->BestNode(belief, value);
+}
+
+int AlphaVectorSet::PruneDominated()
+{
+    const int N = this->GetSize();
+    const int S = this->S_size;
+
+    // a dominating vector has a sum at least as large, so only earlier rows in
+    // decreasing-sum order need to be checked
+    vector<double> sums(N, 0.0);
+    vector<int> order(N);
+    for (int r = 0; r < N; r++)
+    {
+        const double *row = this->GetRow(r);
+        for (int sI = 0; sI < S; sI++)
+            sums[r] += row[sI];
+        order[r] = r;
+    }
+    stable_sort(order.begin(), order.end(), [&](int x, int y)
+                { return sums[x] > sums[y]; });
+
+    vector<int> kept_rows;
+    vector<bool> keep(N, false);
+    for (int r : order)
+    {
+        const double *row = this->GetRow(r);
+        bool dominated = false;
+        for (int k : kept_rows)
+        {
+            const double *other = this->GetRow(k);
+            int sI = 0;
+            while (sI < S && other[sI] >= row[sI])
+                sI++;
+            if (sI == S)
+            {
+                dominated = true;
+                break;
+            }
+        }
+        if (!dominated)
+        {
+            kept_rows.push_back(r);
+            keep[r] = true;
+        }
+    }
+
+    // compact in place, keeping the original row order
+    int nb_kept = 0;
+    for (int r = 0; r < N; r++)
+    {
+        if (!keep[r])
+            continue;
+        if (nb_kept != r)
+        {
+            copy(this->GetRow(r), this->GetRow(r) + this->row_stride,
+                 &this->matrix[(size_t)nb_kept * this->row_stride]);
+            this->node_index[nb_kept] = this->node_index[r];
+        }
+        nb_kept++;
+    }
+    this->matrix.resize((size_t)nb_kept * this->row_stride);
+    this->node_index.resize(nb_kept);
+    return N - nb_kept;
+}
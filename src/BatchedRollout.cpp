@@ -0,0 +1,128 @@
+#include "../include/BatchedRollout.h"
+
+#include <algorithm>
+
+/* group of the next step holding (nI, sI), created on first use */
+int BatchedRollout::FindOrAddGroup(int nI, int sI)
+{
+    const long long key = ((long long)nI << 32) | (unsigned)sI;
+    const size_t mask = this->table_key.size() - 1;
+    size_t h = (size_t)((unsigned long long)key * 0x9e3779b97f4a7c15ULL >> 20) & mask;
+    while (this->table_stamp[h] == this->stamp)
+    {
+        if (this->table_key[h] == key)
+            return this->table_group[h];
+        h = (h + 1) & mask;
+    }
+    int g = this->group_node.size();
+    this->group_node.push_back(nI);
+    this->group_state.push_back(sI);
+    this->group_reward.push_back(0.0);
+    this->group_next.push_back(-1);
+    this->group_size.push_back(0);
+    this->table_stamp[h] = this->stamp;
+    this->table_key[h] = key;
+    this->table_group[h] = g;
+    this->next_active.push_back(g);
+    return g;
+}
+
+void BatchedRollout::Run(const FscPolicyView &policy, int sI, int L, double gamma, SimInterface *sim, double *V,
+                         unsigned long *visits, const unsigned long *step_seeds)
+{
+    const int N = policy.node_size;
+    this->group_node.clear();
+    this->group_state.clear();
+    this->group_reward.clear();
+    this->group_next.clear();
+    this->group_size.clear();
+    this->active.clear();
+
+    // at most N groups are alive at any step, keep the table at most half full
+    size_t capacity = 16;
+    while (capacity < 2 * (size_t)N)
+        capacity *= 2;
+    if (this->table_key.size() < capacity)
+    {
+        this->table_key.assign(capacity, 0);
+        this->table_group.assign(capacity, 0);
+        this->table_stamp.assign(capacity, 0);
+        this->stamp = 0;
+    }
+
+    // every node starts its own group from sI
+    for (int nI = 0; nI < N; nI++)
+    {
+        this->group_node.push_back(nI);
+        this->group_state.push_back(sI);
+        this->group_reward.push_back(0.0);
+        this->group_next.push_back(-1);
+        this->group_size.push_back(1);
+        this->active.push_back(nI);
+    }
+
+    double discount = 1.0;
+    for (int step = 0; step < L && !this->active.empty(); step++)
+    {
+        if (++this->stamp == 0)
+        {
+            fill(this->table_stamp.begin(), this->table_stamp.end(), 0);
+            this->stamp = 1;
+        }
+        this->next_active.clear();
+        for (int g : this->active)
+        {
+            const int nI = this->group_node[g];
+            const int aI = policy.GetAction(nI);
+            if (aI < 0)
+                continue;
+            int s_newI, oI;
+            double r;
+            bool done;
+            if (step_seeds)
+                sim->SetSeed(step_seeds[step]);
+            tie(s_newI, oI, r, done) = sim->Step(this->group_state[g], aI);
+            this->nb_sim_calls++;
+            this->group_reward[g] = discount * r;
+            if (done)
+            {
+                // terminal state: the members stop here
+                this->nb_ended += this->group_size[g];
+                this->nb_steps_saved += (unsigned long)this->group_size[g] * (L - step - 1);
+                continue;
+            }
+            const int nI_next = policy.GetNextNode(nI, aI, oI);
+            if (visits && nI_next != nI)
+                visits[nI_next] += this->group_size[g];
+            int g_next = this->FindOrAddGroup(nI_next, s_newI);
+            this->group_next[g] = g_next;
+            this->group_size[g_next] += this->group_size[g];
+        }
+        this->active.swap(this->next_active);
+        discount *= gamma;
+    }
+    for (int g : this->active)
+        this->nb_ended += this->group_size[g];
+
+    // groups are created in time order: accumulate the returns from the last one back
+    for (int g = this->group_node.size() - 1; g >= 0; g--)
+        if (this->group_next[g] >= 0)
+            this->group_reward[g] += this->group_reward[this->group_next[g]];
+    for (int nI = 0; nI < N; nI++)
+        V[nI] = this->group_reward[nI];
+}
+
+unsigned long BatchedRollout::GetNbSimCalls() const
+{
+    return this->nb_sim_calls;
+}
+
+unsigned long BatchedRollout::GetNbEnded() const
+{
+    return this->nb_ended;
+}
+
+unsigned long BatchedRollout::GetNbStepsSaved() const
+{
+    return this->nb_steps_saved;
+}
@@ -0,0 +1,371 @@
+#include "../include/BeliefTreeSearch.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <limits>
+#include <thread>
+#include "../include/SeedMixing.h"
+
+BeliefTreeSearch::BeliefTreeSearch(MCVI *mcvi, SimInterface *sim, const BoundInterface *bounds,
+                                   const BeliefTreeParameters &params)
+    : mcvi(mcvi), sim(sim), bounds(bounds), params(params), A_size(sim->GetSizeOfA()),
+      Obs_size(sim->GetSizeOfObs()), discount(sim->GetDiscount())
+{
+    if (params.backup_batch > 1 && params.nb_concurrent_trials > 1)
+    {
+        cerr << "batched backups run trials one at a time" << endl;
+        this->params.nb_concurrent_trials = 1;
+    }
+    // the backups use sim, concurrent trials need their own simulators
+    if (this->params.nb_concurrent_trials > 1)
+    {
+        for (int t = 0; t < params.nb_concurrent_trials; t++)
+        {
+            SimInterface *clone = sim->Clone();
+            if (!clone)
+            {
+                cerr << "simulator cannot be cloned, trials run one at a time" << endl;
+                this->owned_sims.clear();
+                this->trial_sims.clear();
+                break;
+            }
+            this->owned_sims.emplace_back(clone);
+            this->trial_sims.push_back(clone);
+        }
+    }
+    else if (this->params.nb_threads > 1)
+    {
+        // a single trial expands on sim and on clones of it, between two backups
+        this->expand_sims.push_back(sim);
+        for (int w = 1; w < params.nb_threads; w++)
+        {
+            SimInterface *clone = sim->Clone();
+            if (!clone)
+            {
+                cerr << "simulator cannot be cloned, expansions run on one thread" << endl;
+                break;
+            }
+            this->owned_sims.emplace_back(clone);
+            this->expand_sims.push_back(clone);
+        }
+        if (this->expand_sims.size() > 1)
+            this->expand_scheduler.reset(new WorkStealingScheduler(this->expand_sims.size()));
+    }
+
+    vector<int> b0 = mcvi->GetInitBelief();
+    if (b0.empty())
+        b0 = mcvi->SampleStartBelief(params.nb_particles);
+    this->AddNode(b0, 0);
+}
+
+BeliefTreeSearch::~BeliefTreeSearch()
+{
+}
+
+/* called with tree_mutex held, or before the search starts */
+int BeliefTreeSearch::AddNode(const vector<int> &particles, int depth)
+{
+    unique_ptr<BeliefTreeNode> node(new BeliefTreeNode());
+    node->particles = particles;
+    node->depth = depth;
+    node->upper = this->bounds->GetUpperBound(particles);
+    node->lower = this->bounds->GetLowerBound(particles);
+    this->nodes.push_back(move(node));
+    return this->nodes.size() - 1;
+}
+
+bool BeliefTreeSearch::Expand(int id, SimInterface *sim)
+{
+    const int A = this->A_size;
+    const int O = this->Obs_size;
+    vector<int> particles;
+    int depth;
+    {
+        lock_guard<mutex> lock(this->tree_mutex);
+        if (this->nodes[id]->expanded)
+            return false;
+        particles = this->nodes[id]->particles;
+        depth = this->nodes[id]->depth;
+    }
+
+    // step nb_particles particles drawn from the belief for every action, outside the lock;
+    // tasks of a block of particles of one action, seeded by the task and merged in order
+    const int n = max(1, this->params.nb_particles);
+    const int block_size = 64;
+    const int nb_blocks = (n + block_size - 1) / block_size;
+    const int nb_tasks = A * nb_blocks;
+    vector<double> task_reward(nb_tasks, 0.0);
+    vector<vector<int>> task_obs(nb_tasks), task_particles(nb_tasks);
+    auto step_block = [&](int task, SimInterface *sim)
+    {
+        const int aI = task / nb_blocks;
+        const int blk = task % nb_blocks;
+        const unsigned long seed = MixSeed(this->params.seed ^ MixSeed((unsigned long)id * A + aI));
+        sim->SetSeed(MixSeed(seed ^ (unsigned long)blk));
+        for (int j = blk * block_size; j < min(n, (blk + 1) * block_size); j++)
+        {
+            int sI = particles[MixSeed(seed + j) % particles.size()];
+            int s_newI, oI;
+            double r;
+            bool done;
+            tie(s_newI, oI, r, done) = sim->Step(sI, aI);
+            task_reward[task] += r;
+            // terminal outcomes only contribute their reward
+            if (done)
+                continue;
+            task_obs[task].push_back(oI);
+            task_particles[task].push_back(s_newI);
+        }
+    };
+    if (this->expand_scheduler)
+        this->expand_scheduler->ParallelFor(nb_tasks, [&](int task, int worker)
+                                            { step_block(task, this->expand_sims[worker]); });
+    else
+        for (int task = 0; task < nb_tasks; task++)
+            step_block(task, sim);
+
+    vector<double> reward(A, 0.0);
+    vector<double> obs_prob((size_t)A * O, 0.0);
+    vector<vector<int>> child_particles((size_t)A * O);
+    for (int task = 0; task < nb_tasks; task++)
+    {
+        const int aI = task / nb_blocks;
+        reward[aI] += task_reward[task] / n;
+        for (size_t k = 0; k < task_obs[task].size(); k++)
+        {
+            const int oI = task_obs[task][k];
+            obs_prob[(size_t)aI * O + oI] += 1.0 / n;
+            child_particles[(size_t)aI * O + oI].push_back(task_particles[task][k]);
+        }
+    }
+
+    lock_guard<mutex> lock(this->tree_mutex);
+    if (this->nodes[id]->expanded)
+        return false;
+    vector<int> child((size_t)A * O, -1);
+    for (size_t k = 0; k < child.size(); k++)
+        if (!child_particles[k].empty())
+            child[k] = this->AddNode(child_particles[k], depth + 1);
+    BeliefTreeNode &node = *this->nodes[id];
+    node.reward.swap(reward);
+    node.obs_prob.swap(obs_prob);
+    node.child.swap(child);
+    node.expanded = true;
+    return true;
+}
+
+/* R(b,a) + gamma * sum_o p(o|b,a) U(b_ao), called with tree_mutex held */
+double BeliefTreeSearch::GetQUpper(const BeliefTreeNode &node, int aI) const
+{
+    const int O = this->Obs_size;
+    double Q = node.reward[aI];
+    for (int oI = 0; oI < O; oI++)
+    {
+        int c = node.child[(size_t)aI * O + oI];
+        if (c >= 0)
+            Q += this->discount * node.obs_prob[(size_t)aI * O + oI] * this->nodes[c]->upper;
+    }
+    return Q;
+}
+
+vector<int> BeliefTreeSearch::Descend(SimInterface *sim, double epsilon)
+{
+    const int A = this->A_size;
+    const int O = this->Obs_size;
+    vector<int> path;
+    int id = 0;
+    while (true)
+    {
+        {
+            lock_guard<mutex> lock(this->tree_mutex);
+            BeliefTreeNode &b = *this->nodes[id];
+            path.push_back(id);
+            b.virtual_loss++;
+            double threshold = epsilon / pow(this->discount, b.depth);
+            if (b.depth >= this->params.max_depth || b.upper - b.lower <= threshold)
+                break;
+        }
+        this->Expand(id, sim);
+
+        lock_guard<mutex> lock(this->tree_mutex);
+        const BeliefTreeNode &b = *this->nodes[id];
+        // action with the largest upper bound, penalized by the trials already taking it
+        int a_best = -1;
+        double best_Q = -numeric_limits<double>::infinity();
+        for (int aI = 0; aI < A; aI++)
+        {
+            int busy = 0;
+            for (int oI = 0; oI < O; oI++)
+            {
+                int c = b.child[(size_t)aI * O + oI];
+                if (c >= 0)
+                    busy += this->nodes[c]->virtual_loss;
+            }
+            double Q = this->GetQUpper(b, aI) - this->params.virtual_loss * busy;
+            if (Q > best_Q)
+            {
+                best_Q = Q;
+                a_best = aI;
+            }
+        }
+        // observation with the largest weighted excess gap
+        const double threshold = epsilon / pow(this->discount, b.depth + 1);
+        int next = -1;
+        double best_score = 0.0;
+        for (int oI = 0; oI < O; oI++)
+        {
+            int c = b.child[(size_t)a_best * O + oI];
+            if (c < 0)
+                continue;
+            const BeliefTreeNode &child = *this->nodes[c];
+            double score = b.obs_prob[(size_t)a_best * O + oI] * (child.upper - child.lower - threshold) /
+                           (1.0 + child.virtual_loss);
+            if (score > best_score)
+            {
+                best_score = score;
+                next = c;
+            }
+        }
+        if (next < 0)
+            break;
+        id = next;
+    }
+    return path;
+}
+
+void BeliefTreeSearch::BackUpPaths(const vector<vector<int>> &paths)
+{
+    const int A = this->A_size;
+    size_t max_length = 0;
+    for (const vector<int> &path : paths)
+        max_length = max(max_length, path.size());
+
+    // round k backs up the k-th last belief of every path, so each path goes from its end
+    for (size_t k = 1; k <= max_length; k++)
+    {
+        vector<int> ids;
+        vector<vector<int>> beliefs;
+        {
+            lock_guard<mutex> lock(this->tree_mutex);
+            for (const vector<int> &path : paths)
+            {
+                if (path.size() < k)
+                    continue;
+                const int id = path[path.size() - k];
+                // a belief shared by several paths is backed up once per round
+                if (find(ids.begin(), ids.end(), id) != ids.end())
+                {
+                    this->nodes[id]->virtual_loss--;
+                    continue;
+                }
+                ids.push_back(id);
+                beliefs.push_back(this->nodes[id]->particles);
+            }
+        }
+
+        // the backup value overestimates the node, its evaluation gives a lower bound
+        vector<double> values(ids.size(), -numeric_limits<double>::infinity());
+        {
+            lock_guard<mutex> lock(this->backup_mutex);
+            const vector<int> backed_up = ids.size() == 1 ? vector<int>(1, this->mcvi->BackUp(beliefs[0]))
+                                                           : this->mcvi->BackUpConcurrent(beliefs);
+            // promoting renumbers the controller, so it comes after every evaluation
+            int start = -1;
+            for (size_t j = 0; j < ids.size(); j++)
+            {
+                if (backed_up[j] < 0)
+                    continue;
+                values[j] = this->mcvi->EvaluateController(beliefs[j], backed_up[j]).lower;
+                if (ids[j] == 0)
+                    start = backed_up[j];
+            }
+            if (start >= 0)
+                this->mcvi->PromoteToStart(start);
+        }
+
+        lock_guard<mutex> lock(this->tree_mutex);
+        for (size_t j = 0; j < ids.size(); j++)
+        {
+            BeliefTreeNode &b = *this->nodes[ids[j]];
+            b.lower = max(b.lower, values[j]);
+            if (b.expanded)
+            {
+                double U = -numeric_limits<double>::infinity();
+                for (int aI = 0; aI < A; aI++)
+                    U = max(U, this->GetQUpper(b, aI));
+                b.upper = min(b.upper, U);
+            }
+            b.virtual_loss--;
+        }
+    }
+}
+
+int BeliefTreeSearch::Search(int max_trials, double epsilon)
+{
+    atomic<int> next_trial{0};
+    auto run = [&](SimInterface *sim)
+    {
+        while (true)
+        {
+            {
+                lock_guard<mutex> lock(this->tree_mutex);
+                if (this->nodes[0]->upper - this->nodes[0]->lower <= epsilon)
+                    return;
+            }
+            // with batched backups the trials of a batch descend one after another, each
+            // steered away from the others by its virtual loss
+            const int nb_batch = max(1, this->params.backup_batch);
+            const int t = next_trial.fetch_add(nb_batch);
+            if (t >= max_trials)
+                return;
+            vector<vector<int>> paths;
+            for (int k = 0; k < nb_batch && t + k < max_trials; k++)
+                paths.push_back(this->Descend(sim, epsilon));
+            this->BackUpPaths(paths);
+
+            lock_guard<mutex> backup_lock(this->backup_mutex);
+            lock_guard<mutex> lock(this->tree_mutex);
+            this->nb_trials += paths.size();
+            if (this->log)
+                *this->log << "trial " << this->nb_trials << ": beliefs " << this->nodes.size() << ", nodes "
+                           << this->mcvi->GetFSC().GetNodeSize() << ", bounds [" << this->nodes[0]->lower << ", "
+                           << this->nodes[0]->upper << "]" << endl;
+        }
+    };
+
+    const int nb_before = this->nb_trials;
+    if (this->trial_sims.empty())
+    {
+        run(this->sim);
+    }
+    else
+    {
+        vector<thread> workers;
+        for (SimInterface *s : this->trial_sims)
+            workers.emplace_back(run, s);
+        for (auto &w : workers)
+            w.join();
+    }
+    return this->nb_trials - nb_before;
+}
+
+double BeliefTreeSearch::GetUpperBound() const
+{
+    return this->nodes[0]->upper;
+}
+
+double BeliefTreeSearch::GetLowerBound() const
+{
+    return this->nodes[0]->lower;
+}
+
+int BeliefTreeSearch::GetNbBeliefs() const
+{
+    return this->nodes.size();
+}
+
+void BeliefTreeSearch::SetLog(ostream *log)
+{
+    this->log = log;
+}
@@ -0,0 +1,303 @@
+#include "../include/DistributedEvaluator.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <deque>
+#include <poll.h>
+#include "../include/MCVIWorker.h"
+
+DistributedEvaluator::DistributedEvaluator(const MCVIParameters &params, int A_size, int Obs_size)
+    : params(params), A_size(A_size), Obs_size(Obs_size)
+{
+}
+
+DistributedEvaluator::~DistributedEvaluator()
+{
+    this->Shutdown();
+}
+
+bool DistributedEvaluator::AddWorker(const string &address, double timeout)
+{
+    unique_ptr<WorkerLink> worker(new WorkerLink());
+    worker->address = address;
+    if (!worker->channel.Connect(address, timeout))
+        return false;
+
+    MessageWriter hello;
+    hello.Put(MCVI_PROTOCOL_VERSION);
+    hello.Put((int32_t)this->A_size);
+    hello.Put((int32_t)this->Obs_size);
+    hello.Put((uint64_t)this->params.seed);
+    hello.Put((int32_t)this->params.L);
+    hello.Put((int32_t)this->params.nb_sample);
+    hello.Put((uint8_t)this->params.common_random_numbers);
+    hello.Put((uint8_t)this->params.batched_rollouts);
+    uint32_t type;
+    vector<uint8_t> reply;
+    if (!worker->channel.Send(MSG_HELLO, hello.data) || !worker->channel.Receive(type, reply))
+    {
+        cerr << "worker " << address << " does not answer" << endl;
+        return false;
+    }
+    if (type != MSG_HELLO_OK)
+    {
+        cerr << "worker " << address << " refused: " << string(reply.begin(), reply.end()) << endl;
+        return false;
+    }
+    this->workers.push_back(move(worker));
+    return true;
+}
+
+int DistributedEvaluator::GetNbWorkers() const
+{
+    return this->workers.size();
+}
+
+void DistributedEvaluator::SetJobTimeout(double seconds)
+{
+    this->job_timeout = max(0.0, seconds);
+}
+
+void DistributedEvaluator::Shutdown()
+{
+    for (auto &worker : this->workers)
+        worker->channel.Send(MSG_SHUTDOWN, vector<uint8_t>());
+    this->workers.clear();
+}
+
+void DistributedEvaluator::DropWorker(int w)
+{
+    cerr << "worker " << this->workers[w]->address << " failed, dropping it" << endl;
+    this->workers.erase(this->workers.begin() + w);
+}
+
+bool DistributedEvaluator::SendJob(WorkerLink &worker, const FscPolicyTable &snapshot,
+                                   const vector<unsigned long> &versions, unsigned long snapshot_version,
+                                   const vector<int> &belief, const SampleJob &job)
+{
+    const int A = this->A_size;
+    const int O = this->Obs_size;
+    const int N = snapshot.GetNodeSize();
+    MessageWriter out;
+    out.Put((uint64_t)job.backup_id);
+    out.Put((int32_t)job.aI);
+    out.Put((int32_t)job.i_begin);
+    out.Put((int32_t)job.i_end);
+    out.Put((int32_t)job.horizon);
+    out.Put((uint64_t)worker.controller_version);
+    out.Put((uint64_t)snapshot_version);
+    out.Put((int32_t)N);
+
+    // nodes changed since the version the worker has
+    vector<int32_t> changed;
+    for (int nI = 0; nI < N; nI++)
+        if (versions[nI] > worker.controller_version)
+            changed.push_back(nI);
+    out.Put((int32_t)changed.size());
+    vector<int32_t> row((size_t)A * O);
+    for (int32_t nI : changed)
+    {
+        out.Put(nI);
+        out.Put((int32_t)snapshot.GetBestAction(nI));
+        for (int aI = 0; aI < A; aI++)
+            for (int oI = 0; oI < O; oI++)
+                row[(size_t)aI * O + oI] = snapshot.GetEtaValue(nI, aI, oI);
+        out.PutArray(row.data(), row.size());
+    }
+
+    const bool send_belief = !worker.has_belief || worker.belief_backup_id != job.backup_id;
+    out.Put((uint8_t)send_belief);
+    if (send_belief)
+    {
+        // samples pick particles by index, so the order is kept
+        out.Put((uint64_t)belief.size());
+        out.PutArray(belief.data(), belief.size());
+    }
+    if (!worker.channel.Send(MSG_JOB, out.data))
+        return false;
+    this->nb_bytes_sent += out.data.size();
+    this->nb_nodes_sent += changed.size();
+    worker.controller_version = snapshot_version;
+    worker.belief_backup_id = job.backup_id;
+    worker.has_belief = true;
+    worker.nb_jobs++;
+    return true;
+}
+
+bool DistributedEvaluator::ReadResult(WorkerLink &worker, int N, SampleJobResult &result)
+{
+    const int O = this->Obs_size;
+    uint32_t type;
+    vector<uint8_t> payload;
+    if (!worker.channel.Receive(type, payload))
+        return false;
+    if (type != MSG_RESULT)
+    {
+        if (type == MSG_ERROR)
+            cerr << "worker " << worker.address << ": " << string(payload.begin(), payload.end()) << endl;
+        return false;
+    }
+    this->nb_bytes_received += payload.size();
+    MessageReader in(payload);
+    uint64_t nb_sim_calls;
+    int32_t N_worker;
+    in.Get(nb_sim_calls);
+    in.Get(N_worker);
+    if (N_worker != N)
+        return false;
+    result.nb_sim_calls = nb_sim_calls;
+    result.acc.resize(1 + O + (size_t)O * N);
+    in.GetArray(result.acc.data(), result.acc.size());
+    vector<uint64_t> visits(N);
+    in.GetArray(visits.data(), visits.size());
+    result.visits.assign(visits.begin(), visits.end());
+    return in.ok && in.p == in.end;
+}
+
+bool DistributedEvaluator::DiscardResult(WorkerLink &worker)
+{
+    uint32_t type;
+    vector<uint8_t> payload;
+    if (!worker.channel.Receive(type, payload) || type != MSG_RESULT)
+        return false;
+    this->nb_bytes_received += payload.size();
+    worker.nb_stale--;
+    return true;
+}
+
+/* milliseconds from now to t for poll, at least 0 */
+static int MillisecondsUntil(chrono::steady_clock::time_point now, chrono::steady_clock::time_point t)
+{
+    const double ms = chrono::duration<double, milli>(t - now).count();
+    return (int)min(ceil(max(ms, 0.0)), (double)INT32_MAX);
+}
+
+bool DistributedEvaluator::EvaluateSamples(const FscPolicyTable &snapshot, const vector<unsigned long> &versions,
+                                           const vector<int> &belief, const vector<SampleJob> &jobs,
+                                           vector<SampleJobResult> &results, chrono::steady_clock::time_point deadline)
+{
+    const bool has_deadline = deadline != chrono::steady_clock::time_point::max();
+    const int N = snapshot.GetNodeSize();
+    unsigned long snapshot_version = 0;
+    for (int nI = 0; nI < N; nI++)
+        snapshot_version = max(snapshot_version, versions[nI]);
+
+    results.assign(jobs.size(), SampleJobResult());
+    deque<int> queue;
+    for (size_t j = 0; j < jobs.size(); j++)
+        queue.push_back(j);
+    // job in flight on each worker, -1 if idle, and when it was sent
+    vector<int> in_flight;
+    vector<chrono::steady_clock::time_point> sent_at;
+    const auto timeout = chrono::duration_cast<chrono::steady_clock::duration>(
+        chrono::duration<double>(this->job_timeout));
+    size_t nb_done = 0;
+
+    auto dispatch = [&](int w) -> bool
+    {
+        if (queue.empty())
+            return true;
+        const int j = queue.front();
+        if (!this->SendJob(*this->workers[w], snapshot, versions, snapshot_version, belief, jobs[j]))
+            return false;
+        queue.pop_front();
+        in_flight[w] = j;
+        sent_at[w] = chrono::steady_clock::now();
+        return true;
+    };
+    auto drop = [&](int w)
+    {
+        if (in_flight[w] >= 0)
+            queue.push_front(in_flight[w]);
+        in_flight.erase(in_flight.begin() + w);
+        sent_at.erase(sent_at.begin() + w);
+        this->DropWorker(w);
+    };
+
+    in_flight.assign(this->workers.size(), -1);
+    sent_at.assign(this->workers.size(), chrono::steady_clock::now());
+    for (int w = (int)this->workers.size() - 1; w >= 0; w--)
+        if (!dispatch(w))
+            drop(w);
+
+    vector<pollfd> fds;
+    while (nb_done < jobs.size())
+    {
+        if (this->workers.empty())
+            return false;
+        // workers that lost their job to a failed send get a new one
+        for (int w = (int)this->workers.size() - 1; w >= 0; w--)
+            if (in_flight[w] < 0 && !dispatch(w))
+                drop(w);
+        if (this->workers.empty())
+            return false;
+        const auto now = chrono::steady_clock::now();
+        if (has_deadline && now >= deadline)
+        {
+            for (size_t w = 0; w < this->workers.size(); w++)
+                if (in_flight[w] >= 0)
+                    this->workers[w]->nb_stale++;
+            return false;
+        }
+        // wait until a worker answers, the oldest job in flight times out or the deadline
+        int wait_ms = has_deadline ? MillisecondsUntil(now, deadline) : -1;
+        fds.clear();
+        for (size_t w = 0; w < this->workers.size(); w++)
+        {
+            fds.push_back(pollfd{this->workers[w]->channel.GetFd(), POLLIN, 0});
+            if (this->job_timeout > 0.0 && in_flight[w] >= 0)
+            {
+                const int left_ms = MillisecondsUntil(now, sent_at[w] + timeout);
+                wait_ms = wait_ms < 0 ? left_ms : min(wait_ms, left_ms);
+            }
+        }
+        if (poll(fds.data(), fds.size(), wait_ms) < 0)
+            return false;
+        for (int w = (int)this->workers.size() - 1; w >= 0; w--)
+        {
+            if (!(fds[w].revents & (POLLIN | POLLHUP | POLLERR)))
+            {
+                if (this->job_timeout > 0.0 && in_flight[w] >= 0 &&
+                    chrono::steady_clock::now() - sent_at[w] >= timeout)
+                {
+                    cerr << "worker " << this->workers[w]->address << " did not answer within "
+                         << this->job_timeout << " s" << endl;
+                    drop(w);
+                }
+                continue;
+            }
+            if (this->workers[w]->nb_stale > 0)
+            {
+                if (!this->DiscardResult(*this->workers[w]))
+                    drop(w);
+                continue;
+            }
+            if (in_flight[w] < 0 || !this->ReadResult(*this->workers[w], N, results[in_flight[w]]))
+            {
+                drop(w);
+                continue;
+            }
+            in_flight[w] = -1;
+            nb_done++;
+            if (!dispatch(w))
+                drop(w);
+        }
+    }
+    return true;
+}
+
+unsigned long DistributedEvaluator::GetNbBytesSent() const
+{
+    return this->nb_bytes_sent;
+}
+
+unsigned long DistributedEvaluator::GetNbBytesReceived() const
+{
+    return this->nb_bytes_received;
+}
+
+unsigned long DistributedEvaluator::GetNbNodesSent() const
+{
+    return this->nb_nodes_sent;
+}
@@ -0,0 +1,135 @@
+#include "../include/FscCodeGen.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <fstream>
+#include <vector>
+
+/* smallest fixed-width integer type holding [min_value, max_value] */
+static string SmallestIntType(long long min_value, long long max_value)
+{
+    if (min_value >= 0)
+    {
+        if (max_value <= UINT8_MAX)
+            return "uint8_t";
+        if (max_value <= UINT16_MAX)
+            return "uint16_t";
+        return "uint32_t";
+    }
+    if (min_value >= INT8_MIN && max_value <= INT8_MAX)
+        return "int8_t";
+    if (min_value >= INT16_MIN && max_value <= INT16_MAX)
+        return "int16_t";
+    return "int32_t";
+}
+
+static void WriteTable(ostream &os, const string &type, const string &table, const string &size,
+                       const vector<int> &values)
+{
+    os << "constexpr " << type << " " << table << "[" << size << "] = {";
+    for (size_t i = 0; i < values.size(); i++)
+    {
+        if (i > 0)
+            os << (i % 16 == 0 ? ",\n    " : ", ");
+        else
+            os << "\n    ";
+        os << values[i];
+    }
+    os << "\n};\n\n";
+}
+
+bool IsValidCppIdentifier(const string &name)
+{
+    static const char *const keywords[] = {
+        "alignas", "alignof", "and", "and_eq", "asm", "auto", "bitand", "bitor", "bool", "break", "case", "catch",
+        "char", "char8_t", "char16_t", "char32_t", "class", "compl", "concept", "const", "consteval", "constexpr",
+        "constinit", "const_cast", "continue", "co_await", "co_return", "co_yield", "decltype", "default", "delete",
+        "do", "double", "dynamic_cast", "else", "enum", "explicit", "export", "extern", "false", "float", "for",
+        "friend", "goto", "if", "inline", "int", "long", "mutable", "namespace", "new", "noexcept", "not", "not_eq",
+        "nullptr", "operator", "or", "or_eq", "private", "protected", "public", "register", "reinterpret_cast",
+        "requires", "return", "short", "signed", "sizeof", "static", "static_assert", "static_cast", "struct",
+        "switch", "template", "this", "thread_local", "throw", "true", "try", "typedef", "typeid", "typename",
+        "union", "unsigned", "using", "virtual", "void", "volatile", "wchar_t", "while", "xor", "xor_eq"};
+    if (name.empty() || isdigit((unsigned char)name[0]))
+        return false;
+    for (unsigned char c : name)
+        if (!isalnum(c) && c != '_')
+            return false;
+    for (const char *keyword : keywords)
+        if (name == keyword)
+            return false;
+    return true;
+}
+
+bool ExportFSCToCppHeader(const AlphaVectorFSC &fsc, ostream &os, const string &name)
+{
+    if (!IsValidCppIdentifier(name))
+    {
+        cerr << "not a valid C++ namespace name: " << name << endl;
+        return false;
+    }
+    const int N = fsc.GetNodeSize();
+    const int O = fsc.GetSizeOfObs();
+    vector<int> actions(N);
+    vector<int> eta((size_t)N * O);
+    for (int nI = 0; nI < N; nI++)
+    {
+        int aI = fsc.GetBestAction(nI);
+        actions[nI] = aI;
+        for (int oI = 0; oI < O; oI++)
+        {
+            int n_next = aI < 0 ? -1 : fsc.GetEtaValue(nI, aI, oI);
+            eta[(size_t)nI * O + oI] = n_next < 0 ? nI : n_next;
+        }
+    }
+
+    string guard = name;
+    transform(guard.begin(), guard.end(), guard.begin(), [](unsigned char c)
+              { return isalnum(c) ? toupper(c) : '_'; });
+    guard = "_" + guard + "_FSC_H_";
+
+    // empty tables are not valid C++, keep one dummy entry
+    if (N == 0)
+    {
+        actions.assign(1, 0);
+        eta.assign(1, 0);
+    }
+    string action_type = SmallestIntType(*min_element(actions.begin(), actions.end()),
+                                         *max_element(actions.begin(), actions.end()));
+    string eta_type = SmallestIntType(0, max(N - 1, 0));
+
+    os << "// Generated by ExportFSCToCppHeader, do not edit.\n";
+    os << "// " << N << " nodes, " << fsc.GetSizeOfA() << " actions, " << O << " observations\n\n";
+    os << "#ifndef " << guard << "\n#define " << guard << "\n\n#include <cstdint>\n\n";
+    os << "namespace " << name << "\n{\n\n";
+    os << "constexpr int kNodeSize = " << N << ";\n";
+    os << "constexpr int kSizeOfA = " << fsc.GetSizeOfA() << ";\n";
+    os << "constexpr int kSizeOfObs = " << O << ";\n\n";
+    WriteTable(os, action_type, "kActions", N == 0 ? "1" : "kNodeSize", actions);
+    WriteTable(os, eta_type, "kEta", N == 0 ? "1" : "kNodeSize * kSizeOfObs", eta);
+    os << "// action to execute in node nI\n";
+    os << "inline int GetAction(int nI)\n{\n    return kActions[nI];\n}\n\n";
+    os << "// next node after executing GetAction(nI) and receiving oI\n";
+    os << "inline int Step(int nI, int oI)\n{\n    return kEta[nI * kSizeOfObs + oI];\n}\n\n";
+    os << "} // namespace " << name << "\n\n#endif\n";
+    return true;
+}
+
+bool ExportFSCToCppHeader(const AlphaVectorFSC &fsc, const string &filename, const string &name)
+{
+    if (!IsValidCppIdentifier(name))
+    {
+        cerr << "not a valid C++ namespace name: " << name << endl;
+        return false;
+    }
+    ofstream outfile(filename);
+    if (!outfile.is_open())
+    {
+        cerr << "open file failure: " << filename << endl;
+        return false;
+    }
+    bool ok = ExportFSCToCppHeader(fsc, outfile, name);
+    outfile.close();
+    return ok && !outfile.fail();
+}
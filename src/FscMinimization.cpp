@@ -0,0 +1,259 @@
+#include "../include/FscMinimization.h"
+
+#include <algorithm>
+#include <deque>
+#include <unordered_set>
+
+/* next node on observation oI when executing the node's action, unset edges stay */
+static int Successor(const AlphaVectorFSC &fsc, int nI, int oI)
+{
+    int aI = fsc.GetBestAction(nI);
+    if (aI < 0)
+        return nI;
+    int n_next = fsc.GetEtaValue(nI, aI, oI);
+    return n_next < 0 ? nI : n_next;
+}
+
+/* new_index[nI] = nI's new index when composing two renumberings */
+static void ComposeMap(vector<int> &node_map, const vector<int> &new_index)
+{
+    for (int &n : node_map)
+        n = n < 0 ? -1 : new_index[n];
+}
+
+/* compact class ids in order of the first node of each class, so that node 0 stays 0 */
+static int CompactClasses(const vector<int> &cls, vector<int> &new_index)
+{
+    int max_label = cls.empty() ? -1 : *max_element(cls.begin(), cls.end());
+    vector<int> class_index(max_label + 1, -1);
+    int nb_classes = 0;
+    new_index.assign(cls.size(), -1);
+    for (size_t nI = 0; nI < cls.size(); nI++)
+    {
+        if (class_index[cls[nI]] < 0)
+            class_index[cls[nI]] = nb_classes++;
+        new_index[nI] = class_index[cls[nI]];
+    }
+    return nb_classes;
+}
+
+/* remove nodes that are not reachable from node 0, returns the number removed */
+static int RemoveUnreachable(AlphaVectorFSC &fsc, vector<int> &node_map)
+{
+    const int N = fsc.GetNodeSize();
+    vector<bool> reached(N, false);
+    deque<int> open;
+    reached[0] = true;
+    open.push_back(0);
+    while (!open.empty())
+    {
+        int nI = open.front();
+        open.pop_front();
+        for (int oI = 0; oI < fsc.GetSizeOfObs(); oI++)
+        {
+            int n_next = Successor(fsc, nI, oI);
+            if (!reached[n_next])
+            {
+                reached[n_next] = true;
+                open.push_back(n_next);
+            }
+        }
+    }
+
+    vector<int> new_index(N, -1);
+    int nb_reached = 0;
+    for (int nI = 0; nI < N; nI++)
+        if (reached[nI])
+            new_index[nI] = nb_reached++;
+    if (nb_reached < N)
+    {
+        fsc.Renumber(new_index);
+        ComposeMap(node_map, new_index);
+    }
+    return N - nb_reached;
+}
+
+/* refine cls until every class has the same action and the same successor classes,
+ * returns the number of classes */
+static int RefinePartition(const AlphaVectorFSC &fsc, vector<int> &cls)
+{
+    const int N = fsc.GetNodeSize();
+    const int O = fsc.GetSizeOfObs();
+    const int width = O + 1;
+    vector<int> signature((size_t)N * width);
+    vector<int> order(N);
+    vector<int> new_index;
+    int nb_classes = CompactClasses(cls, new_index);
+    cls = new_index;
+
+    while (true)
+    {
+        for (int nI = 0; nI < N; nI++)
+        {
+            int *sig = &signature[(size_t)nI * width];
+            sig[0] = cls[nI];
+            for (int oI = 0; oI < O; oI++)
+                sig[oI + 1] = cls[Successor(fsc, nI, oI)];
+        }
+        for (int nI = 0; nI < N; nI++)
+            order[nI] = nI;
+        auto less_sig = [&](int x, int y)
+        {
+            return lexicographical_compare(&signature[(size_t)x * width], &signature[(size_t)(x + 1) * width],
+                                           &signature[(size_t)y * width], &signature[(size_t)(y + 1) * width]);
+        };
+        sort(order.begin(), order.end(), less_sig);
+
+        vector<int> refined(N);
+        int nb_refined = 0;
+        for (int i = 0; i < N; i++)
+        {
+            if (i > 0 && less_sig(order[i - 1], order[i]))
+                nb_refined++;
+            refined[order[i]] = nb_refined;
+        }
+
+        // refinement only splits classes, so an unchanged count means a fixed point
+        int nb_previous = nb_classes;
+        nb_classes = CompactClasses(refined, new_index);
+        cls = new_index;
+        if (nb_classes == nb_previous)
+            break;
+    }
+    return nb_classes;
+}
+
+/* merge behaviourally equivalent nodes, returns the number of nodes removed */
+static int MergeEquivalent(AlphaVectorFSC &fsc, vector<int> &node_map)
+{
+    const int N = fsc.GetNodeSize();
+    vector<int> cls(N);
+    for (int nI = 0; nI < N; nI++)
+        cls[nI] = fsc.GetBestAction(nI) + 1;
+    int nb_classes = RefinePartition(fsc, cls);
+    if (nb_classes < N)
+    {
+        fsc.Renumber(cls);
+        ComposeMap(node_map, cls);
+    }
+    return N - nb_classes;
+}
+
+/* merge nodes with the same action whose values are within epsilon of the first node
+ * of their cluster, returns the number of nodes removed */
+static int MergeEpsilon(AlphaVectorFSC &fsc, double value_epsilon, vector<int> &node_map)
+{
+    const int N = fsc.GetNodeSize();
+    vector<int> order(N);
+    for (int nI = 0; nI < N; nI++)
+        order[nI] = nI;
+    sort(order.begin(), order.end(), [&](int x, int y)
+         {
+             int ax = fsc.GetBestAction(x), ay = fsc.GetBestAction(y);
+             if (ax != ay)
+                 return ax < ay;
+             return fsc.GetNode(x).V_node < fsc.GetNode(y).V_node;
+         });
+
+    // clusters are labelled by their lowest node index so that node 0 keeps its slot
+    vector<int> cls(N);
+    size_t head = 0;
+    while (head < order.size())
+    {
+        size_t end = head;
+        int label = order[head];
+        while (end < order.size() && fsc.GetBestAction(order[end]) == fsc.GetBestAction(order[head]) &&
+               fsc.GetNode(order[end]).V_node - fsc.GetNode(order[head]).V_node < value_epsilon)
+        {
+            label = min(label, order[end]);
+            end++;
+        }
+        for (size_t i = head; i < end; i++)
+            cls[order[i]] = label;
+        head = end;
+    }
+
+    vector<int> new_index;
+    int nb_classes = CompactClasses(cls, new_index);
+    if (nb_classes < N)
+    {
+        fsc.Renumber(new_index);
+        ComposeMap(node_map, new_index);
+    }
+    return N - nb_classes;
+}
+
+FscMinimizationReport MinimizeFSC(AlphaVectorFSC &fsc, double value_epsilon, vector<int> *node_map)
+{
+    FscMinimizationReport report;
+    report.nodes_before = fsc.GetNodeSize();
+    vector<int> map(fsc.GetNodeSize());
+    for (int nI = 0; nI < fsc.GetNodeSize(); nI++)
+        map[nI] = nI;
+
+    if (fsc.GetNodeSize() > 0)
+    {
+        const AlphaVectorFSC original = fsc;
+        report.unreachable_removed = RemoveUnreachable(fsc, map);
+        report.equivalent_merged = MergeEquivalent(fsc, map);
+        if (value_epsilon > 0.0)
+        {
+            report.epsilon_merged = MergeEpsilon(fsc, value_epsilon, map);
+            if (report.epsilon_merged > 0)
+            {
+                report.unreachable_removed += RemoveUnreachable(fsc, map);
+                report.equivalent_merged += MergeEquivalent(fsc, map);
+            }
+        }
+        report.policy_preserved = CheckPolicyEquivalence(original, fsc, map);
+    }
+    else
+    {
+        report.policy_preserved = true;
+    }
+
+    report.nodes_after = fsc.GetNodeSize();
+    if (node_map)
+        node_map->swap(map);
+    return report;
+}
+
+bool CheckPolicyEquivalence(const AlphaVectorFSC &original, const AlphaVectorFSC &minimized,
+                            const vector<int> &node_map)
+{
+    if (original.GetNodeSize() == 0)
+        return minimized.GetNodeSize() == 0;
+    if (node_map.empty() || node_map[0] < 0 || original.GetSizeOfObs() != minimized.GetSizeOfObs())
+        return false;
+
+    // walk the product of both controllers from their start nodes
+    const long long M = minimized.GetNodeSize();
+    unordered_set<long long> visited;
+    deque<pair<int, int>> open;
+    open.push_back(make_pair(0, node_map[0]));
+    visited.insert(node_map[0]);
+    while (!open.empty())
+    {
+        int n_orig = open.front().first;
+        int n_min = open.front().second;
+        open.pop_front();
+        if (original.GetBestAction(n_orig) != minimized.GetBestAction(n_min))
+            return false;
+        for (int oI = 0; oI < original.GetSizeOfObs(); oI++)
+        {
+            int next_orig = Successor(original, n_orig, oI);
+            int next_min = Successor(minimized, n_min, oI);
+            if (visited.insert(next_orig * M + next_min).second)
+                open.push_back(make_pair(next_orig, next_min));
+        }
+    }
+    return true;
+}
+
+void PrintMinimizationReport(const FscMinimizationReport &report, ostream &os)
+{
+    os << "FSC minimization: " << report.nodes_before << " -> " << report.nodes_after << " nodes ("
+       << report.unreachable_removed << " unreachable, " << report.equivalent_merged << " equivalent, "
+       << report.epsilon_merged << " epsilon-merged), policy "
+       << (report.policy_preserved ? "preserved" : "changed") << endl;
+}
@@ -0,0 +1,104 @@
+#include "../include/FscNodeReordering.h"
+
+#include <algorithm>
+#include <tuple>
+
+FscVisitProfile ProfileNodeVisits(const AlphaVectorFSC &fsc, SimInterface *sim, int nb_runs, int L)
+{
+    const int O = fsc.GetSizeOfObs();
+    FscVisitProfile profile;
+    profile.node_visits.assign(fsc.GetNodeSize(), 0);
+    profile.edge_visits.assign((size_t)fsc.GetNodeSize() * O, 0);
+    if (fsc.GetNodeSize() == 0)
+        return profile;
+
+    for (int run = 0; run < nb_runs; run++)
+    {
+        int sI = sim->SampleStartState();
+        int nI = 0;
+        for (int step = 0; step < L; step++)
+        {
+            profile.node_visits[nI]++;
+            profile.nb_steps++;
+            int aI = fsc.GetBestAction(nI);
+            if (aI < 0)
+                break;
+            int s_newI, oI;
+            double r;
+            bool done;
+            tie(s_newI, oI, r, done) = sim->Step(sI, aI);
+            profile.edge_visits[(size_t)nI * O + oI]++;
+            int n_next = fsc.GetEtaValue(nI, aI, oI);
+            if (n_next >= 0)
+                nI = n_next;
+            sI = s_newI;
+            if (done)
+                break;
+        }
+    }
+    return profile;
+}
+
+vector<int> ComputeNodeLayout(const AlphaVectorFSC &fsc, const FscVisitProfile &profile)
+{
+    const int N = fsc.GetNodeSize();
+    const int O = fsc.GetSizeOfObs();
+    vector<int> new_index(N, -1);
+    if (N == 0)
+        return new_index;
+
+    // visited nodes by decreasing frequency, ties in creation order
+    vector<int> hot;
+    for (int nI = 1; nI < N; nI++)
+        if (profile.node_visits[nI] > 0)
+            hot.push_back(nI);
+    stable_sort(hot.begin(), hot.end(), [&](int x, int y)
+                { return profile.node_visits[x] > profile.node_visits[y]; });
+
+    int nb_placed = 0;
+    size_t next_hot = 0;
+    int last = 0;
+    new_index[0] = nb_placed++;
+    while (true)
+    {
+        // extend the chain with the most frequent unplaced successor of the last node
+        int best_next = -1;
+        uint64_t best_count = 0;
+        int aI = fsc.GetBestAction(last);
+        for (int oI = 0; aI >= 0 && oI < O; oI++)
+        {
+            int n_next = fsc.GetEtaValue(last, aI, oI);
+            uint64_t count = profile.edge_visits[(size_t)last * O + oI];
+            if (n_next >= 0 && new_index[n_next] < 0 && count > best_count)
+            {
+                best_next = n_next;
+                best_count = count;
+            }
+        }
+        if (best_next < 0)
+        {
+            // start a new chain at the hottest remaining node
+            while (next_hot < hot.size() && new_index[hot[next_hot]] >= 0)
+                next_hot++;
+            if (next_hot == hot.size())
+                break;
+            best_next = hot[next_hot];
+        }
+        new_index[best_next] = nb_placed++;
+        last = best_next;
+    }
+
+    // cold nodes keep their relative order
+    for (int nI = 0; nI < N; nI++)
+        if (new_index[nI] < 0)
+            new_index[nI] = nb_placed++;
+    return new_index;
+}
+
+vector<int> ReorderFSCByVisits(AlphaVectorFSC &fsc, SimInterface *sim, int nb_runs, int L)
+{
+    FscVisitProfile profile = ProfileNodeVisits(fsc, sim, nb_runs, L);
+    vector<int> new_index = ComputeNodeLayout(fsc, profile);
+    fsc.Renumber(new_index);
+    return new_index;
+}
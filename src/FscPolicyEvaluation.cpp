@@ -0,0 +1,236 @@
+#include "../include/FscPolicyEvaluation.h"
+
+#include <algorithm>
+#include <cmath>
+
+FscPolicyEvaluator::FscPolicyEvaluator(const PomdpInterface *pomdp, int nb_threads)
+    : pomdp(pomdp), S_size(pomdp->GetSizeOfS()), A_size(pomdp->GetSizeOfA()), Obs_size(pomdp->GetSizeOfObs()),
+      discount(pomdp->GetDiscount()), scheduler(max(1, nb_threads))
+{
+    this->BuildSparseModel();
+}
+
+FscPolicyEvaluator::~FscPolicyEvaluator()
+{
+}
+
+/* flatten T and O into CSR rows, using the sparse distributions when the model has them */
+void FscPolicyEvaluator::BuildSparseModel()
+{
+    const int S = this->S_size;
+    this->trans_start.assign(1, 0);
+    this->obs_start.assign(1, 0);
+    for (int aI = 0; aI < this->A_size; aI++)
+    {
+        for (int sI = 0; sI < S; sI++)
+        {
+            const map<int, double> *trans = this->pomdp->GetTransProbDist(sI, aI);
+            if (trans)
+            {
+                for (const auto &it : *trans)
+                {
+                    if (it.second > 0.0)
+                    {
+                        this->trans_state.push_back(it.first);
+                        this->trans_prob.push_back(it.second);
+                    }
+                }
+            }
+            else
+            {
+                for (int s_newI = 0; s_newI < S; s_newI++)
+                {
+                    double p = this->pomdp->TransFunc(sI, aI, s_newI);
+                    if (p > 0.0)
+                    {
+                        this->trans_state.push_back(s_newI);
+                        this->trans_prob.push_back(p);
+                    }
+                }
+            }
+            this->trans_start.push_back(this->trans_state.size());
+
+            // rows of O are indexed by the arrival state
+            const map<int, double> *obs = this->pomdp->GetObsFuncProbDist(sI, aI);
+            if (obs)
+            {
+                for (const auto &it : *obs)
+                {
+                    if (it.second > 0.0)
+                    {
+                        this->obs_id.push_back(it.first);
+                        this->obs_prob.push_back(it.second);
+                    }
+                }
+            }
+            else
+            {
+                for (int oI = 0; oI < this->Obs_size; oI++)
+                {
+                    double p = this->pomdp->ObsFunc(oI, sI, aI);
+                    if (p > 0.0)
+                    {
+                        this->obs_id.push_back(oI);
+                        this->obs_prob.push_back(p);
+                    }
+                }
+            }
+            this->obs_start.push_back(this->obs_id.size());
+        }
+    }
+}
+
+/* one Gauss-Seidel sweep over nodes [n_begin, n_end), returns the largest update */
+double FscPolicyEvaluator::Sweep(const vector<int> &actions, const vector<int> &successors, int n_begin, int n_end,
+                                 const vector<double> &previous)
+{
+    const int S = this->S_size;
+    const int O = this->Obs_size;
+    double residual = 0.0;
+    for (int nI = n_begin; nI < n_end; nI++)
+    {
+        const int aI = actions[nI];
+        if (aI < 0)
+            continue;
+        const int *succ = &successors[(size_t)nI * O];
+        double *V_n = &this->values[(size_t)nI * S];
+        for (int sI = 0; sI < S; sI++)
+        {
+            const size_t row = (size_t)aI * S + sI;
+            double future = 0.0;
+            for (int t = this->trans_start[row]; t < this->trans_start[row + 1]; t++)
+            {
+                const int s_newI = this->trans_state[t];
+                const size_t obs_row = (size_t)aI * S + s_newI;
+                double v_obs = 0.0;
+                for (int k = this->obs_start[obs_row]; k < this->obs_start[obs_row + 1]; k++)
+                {
+                    const int n_next = succ[this->obs_id[k]];
+                    // own block in place, other blocks from the previous sweep
+                    const vector<double> &src = (n_next >= n_begin && n_next < n_end) ? this->values : previous;
+                    v_obs += this->obs_prob[k] * src[(size_t)n_next * S + s_newI];
+                }
+                future += this->trans_prob[t] * v_obs;
+            }
+            double v = this->pomdp->Reward(sI, aI) + this->discount * future;
+            residual = max(residual, fabs(v - V_n[sI]));
+            V_n[sI] = v;
+        }
+    }
+    return residual;
+}
+
+int FscPolicyEvaluator::Evaluate(const AlphaVectorFSC &fsc, double tolerance, int max_iterations)
+{
+    const int N = fsc.GetNodeSize();
+    const int S = this->S_size;
+    const int O = this->Obs_size;
+
+    // warm start: existing rows are kept, new nodes start from 0
+    if (N < this->nb_nodes)
+        this->Reset();
+    this->values.resize((size_t)N * S, 0.0);
+    this->nb_nodes = N;
+
+    vector<int> actions(N);
+    vector<int> successors((size_t)N * O);
+    for (int nI = 0; nI < N; nI++)
+    {
+        actions[nI] = fsc.GetBestAction(nI);
+        for (int oI = 0; oI < O; oI++)
+        {
+            int n_next = actions[nI] < 0 ? -1 : fsc.GetEtaValue(nI, actions[nI], oI);
+            successors[(size_t)nI * O + oI] = n_next < 0 ? nI : n_next;
+        }
+    }
+
+    const int nb_threads = this->scheduler.GetNbThreads();
+    const int nb_blocks = nb_threads == 1 ? 1 : min(nb_threads * 4, max(1, N));
+    vector<double> previous;
+    vector<double> block_residual(nb_blocks);
+    this->scheduler.ResetStats();
+    int iter = 0;
+    double residual = 0.0;
+    for (iter = 1; iter <= max_iterations; iter++)
+    {
+        if (nb_blocks == 1)
+        {
+            residual = this->Sweep(actions, successors, 0, N, this->values);
+        }
+        else
+        {
+            previous = this->values;
+            this->scheduler.ParallelFor(nb_blocks, [&](int b, int)
+                                        {
+                int n_begin = (long long)N * b / nb_blocks;
+                int n_end = (long long)N * (b + 1) / nb_blocks;
+                block_residual[b] = this->Sweep(actions, successors, n_begin, n_end, previous); });
+            residual = *max_element(block_residual.begin(), block_residual.end());
+        }
+        if (residual < tolerance)
+            break;
+    }
+
+    this->last_iterations = min(iter, max_iterations);
+    this->last_residual = residual;
+    return this->last_iterations;
+}
+
+void FscPolicyEvaluator::Reset()
+{
+    this->values.clear();
+    this->nb_nodes = 0;
+}
+
+void FscPolicyEvaluator::SetWorkStealing(bool stealing)
+{
+    this->scheduler.SetStealing(stealing);
+}
+
+SchedulerStats FscPolicyEvaluator::GetSchedulerStats() const
+{
+    return this->scheduler.GetStats();
+}
+
+int FscPolicyEvaluator::GetNodeSize() const
+{
+    return this->nb_nodes;
+}
+
+int FscPolicyEvaluator::GetLastIterations() const
+{
+    return this->last_iterations;
+}
+
+double FscPolicyEvaluator::GetLastResidual() const
+{
+    return this->last_residual;
+}
+
+double FscPolicyEvaluator::GetValue(int nI, int sI) const
+{
+    return this->values[(size_t)nI * this->S_size + sI];
+}
+
+double FscPolicyEvaluator::GetValue(int nI, const map<int, double> &belief) const
+{
+    double v = 0.0;
+    for (const auto &it : belief)
+        v += it.second * this->GetValue(nI, it.first);
+    return v;
+}
+
+double FscPolicyEvaluator::GetValue(int nI, const vector<int> &particles) const
+{
+    if (particles.empty())
+        return 0.0;
+    double v = 0.0;
+    for (int sI : particles)
+        v += this->GetValue(nI, sI);
+    return v / particles.size();
+}
+
+const vector<double> &FscPolicyEvaluator::GetValues() const
+{
+    return this->values;
+}
@@ -0,0 +1,362 @@
+#include "../include/FscSerialization.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <fstream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const uint64_t FSC_FILE_ALIGN = 64;
+
+static uint64_t AlignUp(uint64_t x)
+{
+    return (x + FSC_FILE_ALIGN - 1) / FSC_FILE_ALIGN * FSC_FILE_ALIGN;
+}
+
+/* true if count items of item_size bytes at offset lie within size bytes, without overflow */
+static bool FitsIn(uint64_t offset, uint64_t count, uint64_t item_size, uint64_t size)
+{
+    return offset <= size && count <= (size - offset) / item_size;
+}
+
+static bool HostIsLittleEndian()
+{
+    const uint32_t one = 1;
+    uint8_t first;
+    memcpy(&first, &one, 1);
+    return first == 1;
+}
+
+static void PutVarint(uint64_t x, vector<uint8_t> &out)
+{
+    while (x >= 0x80)
+    {
+        out.push_back((uint8_t)(x | 0x80));
+        x >>= 7;
+    }
+    out.push_back((uint8_t)x);
+}
+
+static bool GetVarint(const uint8_t *&p, const uint8_t *end, uint64_t &x)
+{
+    x = 0;
+    for (int shift = 0; shift < 64 && p < end; shift += 7)
+    {
+        uint8_t byte = *p++;
+        x |= (uint64_t)(byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+            return true;
+    }
+    return false;
+}
+
+/* sorted histogram of the particles, stored as (state delta, count) varint pairs */
+void CompressBelief(const vector<int> &particles, vector<uint8_t> &out)
+{
+    vector<int> sorted(particles);
+    sort(sorted.begin(), sorted.end());
+    int64_t prev = 0;
+    size_t i = 0;
+    while (i < sorted.size())
+    {
+        size_t j = i;
+        while (j < sorted.size() && sorted[j] == sorted[i])
+            j++;
+        // states are non-negative indices, the first delta is taken from 0
+        PutVarint((uint64_t)(sorted[i] - prev), out);
+        PutVarint(j - i, out);
+        prev = sorted[i];
+        i = j;
+    }
+}
+
+bool DecompressBelief(const uint8_t *data, size_t size, vector<int> &particles)
+{
+    particles.clear();
+    const uint8_t *p = data;
+    const uint8_t *end = data + size;
+    int64_t state = 0;
+    while (p < end)
+    {
+        uint64_t delta, count;
+        if (!GetVarint(p, end, delta) || !GetVarint(p, end, count))
+            return false;
+        if (delta > (uint64_t)INT_MAX - state || count > FSC_MAX_BELIEF_PARTICLES - particles.size())
+            return false;
+        state += delta;
+        particles.insert(particles.end(), count, (int)state);
+    }
+    return true;
+}
+
+bool SaveFSCBinary(const AlphaVectorFSC &fsc, const string &filename, bool with_beliefs)
+{
+    if (!HostIsLittleEndian())
+    {
+        cerr << "fsc binary format requires a little-endian host" << endl;
+        return false;
+    }
+
+    const uint64_t N = fsc.GetNodeSize();
+    const uint64_t nb_edges = N * fsc.GetSizeOfA() * fsc.GetSizeOfObs();
+
+    vector<int32_t> actions(N);
+    vector<double> values(N);
+    for (uint64_t nI = 0; nI < N; nI++)
+    {
+        actions[nI] = fsc.GetBestAction(nI);
+        values[nI] = fsc.GetNode(nI).V_node;
+    }
+    const vector<int> &eta = fsc.GetEta();
+    vector<int32_t> eta32(eta.begin(), eta.end());
+
+    vector<uint64_t> belief_index;
+    vector<uint8_t> belief_data;
+    if (with_beliefs)
+    {
+        belief_index.reserve(N + 1);
+        for (uint64_t nI = 0; nI < N; nI++)
+        {
+            belief_index.push_back(belief_data.size());
+            CompressBelief(fsc.GetNode(nI).state_particles, belief_data);
+        }
+        belief_index.push_back(belief_data.size());
+    }
+
+    FscFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, FSC_FILE_MAGIC, sizeof(header.magic));
+    header.version = FSC_FILE_VERSION;
+    header.flags = with_beliefs ? FSC_FILE_FLAG_BELIEFS : 0;
+    header.A_size = fsc.GetSizeOfA();
+    header.Obs_size = fsc.GetSizeOfObs();
+    header.node_size = N;
+    header.actions_offset = AlignUp(sizeof(FscFileHeader));
+    header.eta_offset = AlignUp(header.actions_offset + N * sizeof(int32_t));
+    header.values_offset = AlignUp(header.eta_offset + nb_edges * sizeof(int32_t));
+    uint64_t end = header.values_offset + N * sizeof(double);
+    if (with_beliefs)
+    {
+        header.belief_index_offset = AlignUp(end);
+        header.belief_data_offset = AlignUp(header.belief_index_offset + (N + 1) * sizeof(uint64_t));
+        header.belief_data_size = belief_data.size();
+        end = header.belief_data_offset + belief_data.size();
+    }
+    header.file_size = end;
+
+    ofstream outfile(filename, ios::binary | ios::trunc);
+    if (!outfile.is_open())
+    {
+        cerr << "open file failure: " << filename << endl;
+        return false;
+    }
+
+    uint64_t pos = 0;
+    auto write_at = [&](uint64_t offset, const void *data, uint64_t size)
+    {
+        static const char zeros[FSC_FILE_ALIGN] = {0};
+        outfile.write(zeros, offset - pos);
+        outfile.write((const char *)data, size);
+        pos = offset + size;
+    };
+    write_at(0, &header, sizeof(header));
+    write_at(header.actions_offset, actions.data(), N * sizeof(int32_t));
+    write_at(header.eta_offset, eta32.data(), nb_edges * sizeof(int32_t));
+    write_at(header.values_offset, values.data(), N * sizeof(double));
+    if (with_beliefs)
+    {
+        write_at(header.belief_index_offset, belief_index.data(), (N + 1) * sizeof(uint64_t));
+        write_at(header.belief_data_offset, belief_data.data(), belief_data.size());
+    }
+
+    outfile.close();
+    return !outfile.fail();
+}
+
+MappedFSC::~MappedFSC()
+{
+    this->Unload();
+}
+
+bool MappedFSC::Load(const string &filename)
+{
+    this->Unload();
+    if (!HostIsLittleEndian())
+    {
+        cerr << "fsc binary format requires a little-endian host" << endl;
+        return false;
+    }
+
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        cerr << "open file failure: " << filename << endl;
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(FscFileHeader))
+    {
+        close(fd);
+        cerr << "not an fsc file: " << filename << endl;
+        return false;
+    }
+    // the mapping stays valid after the descriptor is closed
+    void *addr = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED)
+    {
+        cerr << "mmap failure: " << filename << endl;
+        return false;
+    }
+    this->base = (const uint8_t *)addr;
+    this->mapped_size = st.st_size;
+    this->header = (const FscFileHeader *)addr;
+
+    const FscFileHeader &h = *this->header;
+    const uint64_t N = h.node_size;
+    // a crafted header must not overflow the size checks: N is bounded by the file size
+    // before it is multiplied, A * O fits in 64 bits
+    const uint64_t row = (uint64_t)h.A_size * h.Obs_size;
+    bool valid = memcmp(h.magic, FSC_FILE_MAGIC, sizeof(h.magic)) == 0 && h.version == FSC_FILE_VERSION &&
+                 h.file_size <= this->mapped_size && N <= (uint64_t)INT32_MAX &&
+                 h.actions_offset % FSC_FILE_ALIGN == 0 && h.eta_offset % FSC_FILE_ALIGN == 0 &&
+                 h.values_offset % FSC_FILE_ALIGN == 0 && FitsIn(h.actions_offset, N, sizeof(int32_t), h.file_size) &&
+                 FitsIn(h.values_offset, N, sizeof(double), h.file_size) &&
+                 (row == 0 || N <= h.file_size / row) &&
+                 FitsIn(h.eta_offset, N * row, sizeof(int32_t), h.file_size);
+    if (valid && (h.flags & FSC_FILE_FLAG_BELIEFS))
+    {
+        valid = h.belief_index_offset % FSC_FILE_ALIGN == 0 &&
+                FitsIn(h.belief_index_offset, N + 1, sizeof(uint64_t), h.file_size) &&
+                FitsIn(h.belief_data_offset, h.belief_data_size, 1, h.file_size);
+    }
+    if (!valid)
+    {
+        cerr << "not an fsc file or unsupported version: " << filename << endl;
+        this->Unload();
+        return false;
+    }
+
+    this->actions = (const int32_t *)(this->base + h.actions_offset);
+    this->eta = (const int32_t *)(this->base + h.eta_offset);
+    // the accessors and the execution views index with these without checks
+    for (uint64_t nI = 0; nI < N && valid; nI++)
+        valid = this->actions[nI] >= -1 && this->actions[nI] < (int64_t)h.A_size;
+    for (uint64_t e = 0; e < N * row && valid; e++)
+        valid = this->eta[e] >= -1 && this->eta[e] < (int64_t)N;
+    if (!valid)
+    {
+        cerr << "fsc file with an action or edge out of range: " << filename << endl;
+        this->Unload();
+        return false;
+    }
+    this->values = (const double *)(this->base + h.values_offset);
+    if (h.flags & FSC_FILE_FLAG_BELIEFS)
+    {
+        this->belief_index = (const uint64_t *)(this->base + h.belief_index_offset);
+        this->belief_data = this->base + h.belief_data_offset;
+    }
+    return true;
+}
+
+void MappedFSC::Unload()
+{
+    if (this->base)
+        munmap((void *)this->base, this->mapped_size);
+    this->base = nullptr;
+    this->mapped_size = 0;
+    this->header = nullptr;
+    this->actions = nullptr;
+    this->eta = nullptr;
+    this->values = nullptr;
+    this->belief_index = nullptr;
+    this->belief_data = nullptr;
+}
+
+bool MappedFSC::IsLoaded() const
+{
+    return this->base != nullptr;
+}
+
+int MappedFSC::GetNodeSize() const
+{
+    return this->header ? this->header->node_size : 0;
+}
+
+int MappedFSC::GetSizeOfA() const
+{
+    return this->header ? this->header->A_size : 0;
+}
+
+int MappedFSC::GetSizeOfObs() const
+{
+    return this->header ? this->header->Obs_size : 0;
+}
+
+bool MappedFSC::HasBeliefs() const
+{
+    return this->belief_index != nullptr;
+}
+
+int MappedFSC::GetBestAction(int nI) const
+{
+    return this->actions[nI];
+}
+
+int MappedFSC::GetEtaValue(int nI, int aI, int oI) const
+{
+    return this->eta[((size_t)nI * this->header->A_size + aI) * this->header->Obs_size + oI];
+}
+
+double MappedFSC::GetNodeValue(int nI) const
+{
+    return this->values[nI];
+}
+
+bool MappedFSC::GetBelief(int nI, vector<int> &particles) const
+{
+    particles.clear();
+    if (!this->belief_index)
+        return false;
+    uint64_t begin = this->belief_index[nI];
+    uint64_t end = this->belief_index[nI + 1];
+    if (begin > end || end > this->header->belief_data_size)
+        return false;
+    return DecompressBelief(this->belief_data + begin, end - begin, particles);
+}
+
+const int32_t *MappedFSC::GetActionTable() const
+{
+    return this->actions;
+}
+
+const int32_t *MappedFSC::GetEtaTable() const
+{
+    return this->eta;
+}
+
+bool MappedFSC::ToFSC(AlphaVectorFSC &fsc) const
+{
+    fsc = AlphaVectorFSC(this->GetSizeOfA(), this->GetSizeOfObs());
+    for (int nI = 0; nI < this->GetNodeSize(); nI++)
+    {
+        vector<int> particles;
+        if (this->HasBeliefs() && !this->GetBelief(nI, particles))
+        {
+            cerr << "bad belief of node " << nI << " in fsc file" << endl;
+            return false;
+        }
+        FscNode node = fsc.CreateNode(particles);
+        node.best_action = this->actions[nI];
+        node.V_node = this->values[nI];
+        fsc.AddNode(node);
+    }
+    for (int nI = 0; nI < this->GetNodeSize(); nI++)
+        for (int aI = 0; aI < this->GetSizeOfA(); aI++)
+            for (int oI = 0; oI < this->GetSizeOfObs(); oI++)
+                fsc.UpdateEta(nI, aI, oI, this->GetEtaValue(nI, aI, oI));
+    return true;
+}
@@ -1,86 +1,1678 @@
-#include "../include/AlphaVectorFSC.h"
+#include "../include/MCVI.h"
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <mutex>
+#include "../include/FscSerialization.h"
+#include "../include/MessageChannel.h"
+#include "../include/SeedMixing.h"
 
-// gen function should be implemented!!!
+static unsigned long SampleSeed(unsigned long seed, unsigned long backup, int aI, int i)
+{
+    return MixSeed(MixSeed(MixSeed(seed ^ MixSeed(backup)) ^ (unsigned long)aI) ^ (unsigned long)i);
+}
+
+/* z with P(X > z) = p for a standard normal X, by bisection */
+static double NormalQuantile(double p)
+{
+    double lo = 0.0, hi = 40.0;
+    for (int k = 0; k < 100; k++)
+    {
+        double mid = 0.5 * (lo + hi);
+        if (0.5 * erfc(mid / sqrt(2.0)) > p)
+            lo = mid;
+        else
+            hi = mid;
+    }
+    return 0.5 * (lo + hi);
+}
+
+MCVI::MCVI(SimInterface *sim, const MCVIParameters &params)
+    : sim(sim), params(params), fsc(sim->GetSizeOfA(), sim->GetSizeOfObs()), pool(max(1, params.nb_threads))
+{
+    this->fsc.SetMaxNodeSize(params.max_node_size);
+    this->pool.SetStealing(params.work_stealing);
+    this->worker_sims.push_back(sim);
+    for (int w = 1; w < this->pool.GetNbThreads(); w++)
+    {
+        SimInterface *clone = sim->Clone();
+        if (!clone)
+        {
+            cerr << "simulator cannot be cloned, backups run on one thread" << endl;
+            break;
+        }
+        this->owned_sims.emplace_back(clone);
+        this->worker_sims.push_back(clone);
+    }
+    this->worker_rollouts.resize(this->worker_sims.size());
+    if (params.rollout_cache)
+        this->rollout_cache.reset(new RolloutValueCache(params.rollout_cache_size));
+    if (params.reuse_trajectories && params.rollout_cache)
+        cerr << "reuse_trajectories is ignored while rollout_cache is on" << endl;
+    else if (params.reuse_trajectories)
+        this->trajectory_store.reset(new TrajectoryStore(params.trajectory_store_beliefs, params.trajectory_store_bytes));
+    double r_min, r_max;
+    if (sim->GetRewardBounds(r_min, r_max))
+    {
+        this->has_reward_bounds = true;
+        this->reward_abs_max = max(fabs(r_min), fabs(r_max));
+    }
+}
 
+MCVI::~MCVI()
+{
+}
 
-double SimulateTrajectory(int nI, AlphaVectorFSC fsc, double s, int L, POMDP pomdp){
-    double gamma = std::pow(pomdp.discount(),1.0);
-    double V_n_s =0.0;
+vector<int> MCVI::SampleStartBelief(int nb_particles)
+{
+    this->sim->SetSeed(MixSeed(this->params.seed));
+    vector<int> particles(nb_particles);
+    for (int i = 0; i < nb_particles; i++)
+        particles[i] = this->sim->SampleStartState();
+    return particles;
+}
+
+/* discounted return of at most horizon steps of the controller from (nI, sI), unset
+   edges stay; visits counts the nodes entered from another node. With traj, the recorded
+   steps are replayed as long as the controller still takes them, the rest is simulated,
+   and traj is replaced by the new rollout. */
+double MCVI::SimulateTrajectory(int nI, int sI, int horizon, const FscPolicyView &policy, SimInterface *sim,
+                                const unsigned long *step_seeds, vector<unsigned long> &visits,
+                                TaskCounters &counters, StoredTrajectory *traj) const
+{
+    const double gamma = sim->GetDiscount();
+    double V_n_s = 0.0;
+    double discount = 1.0;
     int nI_current = nI;
-    for (int step =0; step< L;++step){
-        double a = GetBestAction(fsc.nodes[nI_current]);
-        std::vector<double> sp, o, r;
-        // TODO: C++ implementation of the`gen` function
-        
-        if (fsc.eta[nI_current].find(std::make_pair(a, o))!= fsc.eta[nI_current].end()){
-            nI_current = fsc.eta[nI_current][std::make_pair(a, o)];
+    int step = 0;
+
+    if (traj)
+    {
+        const int nb_stored = min((int)traj->steps.size(), horizon);
+        while (step < nb_stored)
+        {
+            const StoredStep &st = traj->steps[step];
+            if (st.nI != nI_current || policy.GetAction(nI_current) != st.aI)
+                break;
+            const int nI_next = policy.GetNextNode(nI_current, st.aI, st.oI);
+            if (nI_next != nI_current)
+                visits[nI_next]++;
+            nI_current = nI_next;
+            V_n_s += discount * st.r;
+            discount *= gamma;
+            sI = st.s_nextI;
+            step++;
+        }
+        counters.nb_replayed_steps += step;
+        if (step == (int)traj->steps.size() && traj->done)
+        {
+            counters.nb_trajectories_reused++;
+            counters.nb_steps_saved += this->params.L - step;
+            return V_n_s;
         }
-        V_n_s +=(gamma^step)*r;
-        s = sp;
+        if (step == horizon)
+        {
+            traj->steps.resize(step);
+            counters.nb_trajectories_reused++;
+            counters.nb_steps_saved += this->params.L - horizon;
+            return V_n_s;
+        }
+        if (step > 0)
+            counters.nb_trajectories_resumed++;
+        traj->steps.resize(step);
+        traj->done = false;
     }
 
+    for (; step < horizon; step++)
+    {
+        int aI = policy.GetAction(nI_current);
+        if (aI < 0)
+            return V_n_s;
+        int s_newI, oI;
+        double r;
+        bool done;
+        if (step_seeds)
+            sim->SetSeed(step_seeds[step]);
+        tie(s_newI, oI, r, done) = sim->Step(sI, aI);
+        counters.nb_sim_calls++;
+        if (traj)
+            traj->steps.push_back({nI_current, aI, oI, s_newI, r});
+        const int nI_next = policy.GetNextNode(nI_current, aI, oI);
+        if (nI_next != nI_current)
+            visits[nI_next]++;
+        nI_current = nI_next;
+        V_n_s += discount * r;
+        discount *= gamma;
+        sI = s_newI;
+        if (done)
+        {
+            if (traj)
+                traj->done = true;
+            counters.nb_steps_saved += this->params.L - step - 1;
+            return V_n_s;
+        }
+    }
+    counters.nb_steps_saved += this->params.L - horizon;
     return V_n_s;
 }
 
-int FindMaxValueNode(int n, AlphaVectorFSC fsc, int a, int o){
-    int max_V = std::numeric_limits<int>::min();
-    int max_nI =1;
-    for (int nI =1; nI< length(fsc.nodes);++nI){
-        double V_temp = fsc.nodes[n].V_a_o_n[a][o][nI];
-        if (V_temp > max_V){
-            max_V = V_temp;
+int MCVI::ComputeRolloutHorizon(double &precision_loss) const
+{
+    const int L = this->params.L;
+    precision_loss = 0.0;
+    if (!this->has_reward_bounds || this->params.rollout_tolerance <= 0.0)
+        return L;
+    // residual[t] = R * sum_{k=t}^{L-1} gamma^k, reward left after t steps
+    const double gamma = this->sim->GetDiscount();
+    vector<double> residual(L + 1, 0.0);
+    double discount = 1.0;
+    for (int t = 0; t < L; t++)
+    {
+        residual[t] = this->reward_abs_max * discount;
+        discount *= gamma;
+    }
+    for (int t = L - 1; t >= 0; t--)
+        residual[t] += residual[t + 1];
+    int horizon = 0;
+    while (residual[horizon] > this->params.rollout_tolerance)
+        horizon++;
+    precision_loss = residual[horizon];
+    return horizon;
+}
+
+/* V_n[nI] = one rollout return of every node from sI */
+void MCVI::RolloutNodes(const FscPolicyView &policy, int sI, int horizon, SimInterface *sim, BatchedRollout &rollout,
+                        const unsigned long *step_seeds, double *V_n, vector<unsigned long> &visits,
+                        TaskCounters &counters) const
+{
+    if (this->params.batched_rollouts)
+    {
+        unsigned long calls_before = rollout.GetNbSimCalls();
+        unsigned long ended_before = rollout.GetNbEnded();
+        unsigned long saved_before = rollout.GetNbStepsSaved();
+        rollout.Run(policy, sI, horizon, sim->GetDiscount(), sim, V_n, visits.data(), step_seeds);
+        counters.nb_sim_calls += rollout.GetNbSimCalls() - calls_before;
+        counters.nb_steps_saved += rollout.GetNbStepsSaved() - saved_before +
+                                   (rollout.GetNbEnded() - ended_before) * (this->params.L - horizon);
+    }
+    else
+    {
+        for (int nI = 0; nI < policy.node_size; nI++)
+            V_n[nI] = this->SimulateTrajectory(nI, sI, horizon, policy, sim, step_seeds, visits, counters);
+    }
+}
+
+/* V_n[nI] = cached mean of every node at sI, after topping up the estimates that miss
+   the variance target; pairs that cannot be cached use a single rollout */
+void MCVI::EstimateNodeValues(const FscPolicyView &policy, int sI, int horizon, SimInterface *sim,
+                              BatchedRollout &rollout, const unsigned long *step_seeds, double *V_n,
+                              vector<double> &V_tmp, vector<unsigned long> &visits, TaskCounters &counters) const
+{
+    const int N = policy.node_size;
+    for (int round = 0;; round++)
+    {
+        bool top_up = false;
+        for (int nI = 0; nI < N; nI++)
+        {
+            RunningStat stat;
+            if (!this->rollout_cache->Lookup(nI, sI, stat))
+            {
+                // not cached yet; past the first round the table had no room for it, and
+                // V_n already holds the last rollout
+                if (round == 0)
+                    top_up = true;
+                continue;
+            }
+            bool need = false;
+            if (stat.count < (unsigned long)max(2, this->params.rollout_cache_min_count) ||
+                stat.GetVariance() > this->params.rollout_cache_variance * stat.count)
+                need = stat.count < (unsigned long)max(1, this->params.rollout_cache_max_count);
+            if (need)
+            {
+                top_up = true;
+                continue;
+            }
+            if (stat.count > 0)
+            {
+                V_n[nI] = stat.mean;
+                if (round == 0)
+                    counters.nb_cache_hits++;
+            }
+        }
+        if (!top_up)
+            return;
+
+        // one rollout of every node, only the first one shares the common random numbers
+        this->RolloutNodes(policy, sI, horizon, sim, rollout, round == 0 ? step_seeds : nullptr, V_tmp.data(),
+                           visits, counters);
+        counters.nb_cache_rollouts++;
+        for (int nI = 0; nI < N; nI++)
+        {
+            this->rollout_cache->Add(nI, sI, V_tmp[nI]);
+            V_n[nI] = V_tmp[nI];
+        }
+    }
+}
+
+int MCVI::FindMaxValueNode(const double *V_n, int nb_nodes) const
+{
+    double max_V = -numeric_limits<double>::infinity();
+    int max_nI = 0;
+    for (int nI = 0; nI < nb_nodes; nI++)
+    {
+        if (V_n[nI] > max_V)
+        {
+            max_V = V_n[nI];
             max_nI = nI;
         }
     }
-    return max_V, max_nI;
+    return max_nI;
+}
+
+/* first step of sample i of action aI and the rollout values V_n of all nodes from the
+   state it reaches; stored is the sample kept from an earlier backup, reused or filled */
+void MCVI::EvaluateSample(const FscPolicyView &policy, const vector<int> &belief, unsigned long backup_id, int aI,
+                          int i, int horizon, SimInterface *sim, BatchedRollout &rollout, StoredSample *stored,
+                          bool use_cache, vector<unsigned long> &step_seeds, vector<double> &V_tmp, double *V_n,
+                          double &r, int &oI, vector<unsigned long> &visits, TaskCounters &counters) const
+{
+    const int N = policy.node_size;
+    const bool crn = this->params.common_random_numbers;
+    // with common random numbers the seed of sample i does not depend on the action
+    const unsigned long seed = SampleSeed(this->params.seed, backup_id, crn ? -1 : aI, i);
+    for (size_t t = 0; t < step_seeds.size(); t++)
+        step_seeds[t] = MixSeed(seed + 1 + t);
+    const unsigned long *rollout_seeds = crn ? step_seeds.data() : nullptr;
+    sim->SetSeed(seed);
+    int s_newI;
+    bool done;
+    // a sample replayed often enough is drawn again from this backup's seed
+    if (stored && stored->valid && this->params.trajectory_store_max_reuse > 0 &&
+        stored->nb_reuses >= this->params.trajectory_store_max_reuse)
+        stored->valid = false;
+    if (stored && stored->valid)
+    {
+        s_newI = stored->s_newI;
+        oI = stored->oI;
+        r = stored->r;
+        done = stored->done;
+        stored->nb_reuses++;
+        counters.nb_reused_samples++;
+    }
+    else
+    {
+        int sI = belief[MixSeed(seed) % belief.size()];
+        tie(s_newI, oI, r, done) = sim->Step(sI, aI);
+        counters.nb_sim_calls++;
+        if (stored)
+        {
+            stored->valid = true;
+            stored->sI = sI;
+            stored->s_newI = s_newI;
+            stored->oI = oI;
+            stored->r = r;
+            stored->done = done;
+            stored->nb_reuses = 0;
+            stored->trajectories.clear();
+        }
+    }
+    if (done)
+    {
+        // nothing follows a terminal state
+        fill(V_n, V_n + N, 0.0);
+        counters.nb_steps_saved += (unsigned long)N * this->params.L;
+    }
+    else if (use_cache)
+    {
+        this->EstimateNodeValues(policy, s_newI, horizon, sim, rollout, rollout_seeds, V_n, V_tmp, visits, counters);
+    }
+    else if (stored)
+    {
+        if ((int)stored->trajectories.size() < N)
+            stored->trajectories.resize(N);
+        for (int nI = 0; nI < N; nI++)
+            V_n[nI] = this->SimulateTrajectory(nI, s_newI, horizon, policy, sim, rollout_seeds, visits, counters,
+                                               &stored->trajectories[nI]);
+    }
+    else
+    {
+        this->RolloutNodes(policy, s_newI, horizon, sim, rollout, rollout_seeds, V_n, visits, counters);
+    }
+}
+
+unsigned long MCVI::EvaluateSamples(const FscPolicyView &policy, const vector<int> &belief, unsigned long backup_id,
+                                    int aI, int i_begin, int i_end, int horizon, vector<double> &acc,
+                                    vector<unsigned long> &visits)
+{
+    const int O = this->fsc.GetSizeOfObs();
+    const int N = policy.node_size;
+    const int nb_samples = max(0, i_end - i_begin);
+    const int nb_workers = max(1, min((int)this->worker_sims.size(), nb_samples));
+    const int nb_tasks = nb_workers == 1 ? 1 : min(nb_samples, nb_workers * max(1, this->params.tasks_per_thread));
+    vector<vector<double>> task_acc(nb_tasks, vector<double>(1 + O + (size_t)O * N, 0.0));
+    vector<vector<unsigned long>> task_visits(nb_tasks, vector<unsigned long>(N, 0));
+    vector<TaskCounters> task_counters(nb_tasks);
+    this->pool.ParallelFor(nb_tasks, [&](int task, int worker)
+                           {
+        vector<unsigned long> step_seeds(this->params.common_random_numbers ? this->params.L : 0);
+        vector<double> V_tmp;
+        vector<double> V_n(N);
+        vector<double> &task_a = task_acc[task];
+        const int t_begin = i_begin + (long long)nb_samples * task / nb_tasks;
+        const int t_end = i_begin + (long long)nb_samples * (task + 1) / nb_tasks;
+        for (int i = t_begin; i < t_end; i++)
+        {
+            double r;
+            int oI;
+            this->EvaluateSample(policy, belief, backup_id, aI, i, horizon, this->worker_sims[worker],
+                                 this->worker_rollouts[worker], nullptr, false, step_seeds, V_tmp, V_n.data(), r, oI,
+                                 task_visits[task], task_counters[task]);
+            task_a[0] += r;
+            task_a[1 + oI] += 1.0;
+            for (int nI = 0; nI < N; nI++)
+                task_a[1 + O + (size_t)oI * N + nI] += V_n[nI];
+        } });
+
+    acc.assign(1 + O + (size_t)O * N, 0.0);
+    visits.assign(N, 0);
+    unsigned long nb_sim_calls = 0;
+    for (int task = 0; task < nb_tasks; task++)
+    {
+        for (size_t k = 0; k < acc.size(); k++)
+            acc[k] += task_acc[task][k];
+        for (int nI = 0; nI < N; nI++)
+            visits[nI] += task_visits[task][nI];
+        nb_sim_calls += task_counters[task].nb_sim_calls;
+    }
+    return nb_sim_calls;
+}
+
+void MCVI::AddStartNode(const vector<int> &belief)
+{
+    unique_lock<shared_mutex> lock(this->fsc_mutex);
+    this->fsc.AddNode(this->fsc.CreateNode(belief));
+    this->BumpNodeVersion(0);
+}
+
+void MCVI::BumpNodeVersion(int nI)
+{
+    if ((int)this->node_versions.size() < this->fsc.GetNodeSize())
+        this->node_versions.resize(this->fsc.GetNodeSize(), 0);
+    this->node_versions[nI] = ++this->version_clock;
+}
+
+int MCVI::BackUp(const vector<int> &belief)
+{
+    unsigned long backup_id;
+    {
+        unique_lock<shared_mutex> lock(this->fsc_mutex);
+        backup_id = this->nb_backups++;
+    }
+    if (this->fsc.GetNodeSize() == 0)
+        this->AddStartNode(belief);
+    this->pool.ResetStats();
+    PendingBackUp pending;
+    this->EvaluateBackUp(belief, backup_id, false, pending);
+    if (pending.aborted)
+        return -1;
+
+    const SchedulerStats scheduler_stats = this->pool.GetStats();
+    pending.stats.load_imbalance = scheduler_stats.GetLoadImbalance();
+    pending.stats.nb_steals = scheduler_stats.nb_steals;
+    unique_lock<shared_mutex> lock(this->fsc_mutex);
+    this->last_backup_stats = pending.stats;
+    return this->CommitBackUp(pending);
+}
+
+vector<int> MCVI::BackUpConcurrent(const vector<vector<int>> &beliefs)
+{
+    const int B = beliefs.size();
+    vector<int> result(B, -1);
+    if (B == 0)
+        return result;
+    if (this->fsc.GetNodeSize() == 0)
+        this->AddStartNode(beliefs[0]);
+    // seeds are fixed by the position in the batch, the outcome depends on the commit order
+    unsigned long first_id;
+    {
+        unique_lock<shared_mutex> lock(this->fsc_mutex);
+        first_id = this->nb_backups;
+        this->nb_backups += B;
+    }
+    this->pool.ResetStats();
+    atomic<int> nb_conflicts{0};
+    atomic<int> nb_discarded{0};
+    MCVIBackUpStats last_stats;
+
+    this->pool.ParallelFor(B, [&](int b, int)
+                           {
+        for (int attempt = 0; attempt <= this->params.max_backup_retries; attempt++)
+        {
+            PendingBackUp pending;
+            this->EvaluateBackUp(beliefs[b], first_id + b, true, pending);
+            if (pending.aborted)
+                return;
+            unique_lock<shared_mutex> lock(this->fsc_mutex);
+            if (!this->IsBackUpValid(pending))
+            {
+                nb_conflicts++;
+                continue;
+            }
+            result[b] = this->CommitBackUp(pending);
+            last_stats = pending.stats;
+            return;
+        }
+        nb_discarded++; });
+
+    const SchedulerStats scheduler_stats = this->pool.GetStats();
+    unique_lock<shared_mutex> lock(this->fsc_mutex);
+    this->last_backup_stats = last_stats;
+    this->last_backup_stats.load_imbalance = scheduler_stats.GetLoadImbalance();
+    this->last_backup_stats.nb_steals = scheduler_stats.nb_steals;
+    this->last_backup_stats.nb_conflicts = nb_conflicts;
+    this->last_backup_stats.nb_discarded = nb_discarded;
+    return result;
+}
+
+bool MCVI::IsBudgetExhausted()
+{
+    if (this->budget_exhausted.load(memory_order_relaxed))
+        return true;
+    if ((this->budget_has_deadline && chrono::steady_clock::now() >= this->budget_deadline) ||
+        (this->budget_max_sim_calls > 0 &&
+         this->budget_sim_calls.load(memory_order_relaxed) >= this->budget_max_sim_calls))
+        this->budget_exhausted = true;
+    return this->budget_exhausted.load(memory_order_relaxed);
+}
+
+bool MCVI::IsBackUpValid(const PendingBackUp &pending) const
+{
+    for (size_t k = 0; k < pending.read_nodes.size(); k++)
+        if (this->node_versions[pending.read_nodes[k]] != pending.read_versions[k])
+            return false;
+    return true;
+}
+
+void MCVI::EvaluateBackUp(const vector<int> &belief, unsigned long backup_id, bool concurrent,
+                          PendingBackUp &pending)
+{
+    const int A = this->fsc.GetSizeOfA();
+    const int O = this->fsc.GetSizeOfObs();
+    const double gamma = this->sim->GetDiscount();
+    // the cache and the store are not safe against concurrent commits
+    RolloutValueCache *const rollout_cache = concurrent ? nullptr : this->rollout_cache.get();
+    TrajectoryStore *const trajectory_store = concurrent ? nullptr : this->trajectory_store.get();
+
+    // rollouts read a flat copy, the controller itself is only changed by the commit
+    FscPolicyTable snapshot;
+    vector<unsigned long> versions;
+    FscNode node;
+    {
+        shared_lock<shared_mutex> lock(this->fsc_mutex);
+        snapshot = FscPolicyTable(this->fsc);
+        versions = this->node_versions;
+        node = this->fsc.CreateNode(belief);
+    }
+    const FscPolicyView policy = snapshot.GetView();
+    const int N = snapshot.GetNodeSize();
+    if (this->budget_active && this->IsBudgetExhausted())
+    {
+        pending.aborted = true;
+        return;
+    }
+
+    // every task owns a contiguous range of samples and its own accumulators, summed in
+    // task order afterwards, so the result only depends on the seed and thread count
+    const int K = this->params.nb_sample;
+    const int nb_workers = max(1, min((int)this->worker_sims.size(), K));
+    const int max_tasks = nb_workers == 1 ? 1 : min(K, nb_workers * max(1, this->params.tasks_per_thread));
+    const size_t acc_size = 1 + O + (size_t)O * N;
+    vector<vector<double>> task_acc(max_tasks, vector<double>(acc_size));
+    vector<vector<unsigned long>> task_visits(max_tasks, vector<unsigned long>(N, 0));
+    vector<TaskCounters> task_counters(max_tasks);
+    // samples of this belief kept from earlier backups
+    StoredSample *stored_samples = nullptr;
+    if (trajectory_store)
+        stored_samples = trajectory_store->GetSamples(TrajectoryStore::HashBelief(belief), A, K);
+    double precision_loss;
+    const int horizon = this->ComputeRolloutHorizon(precision_loss);
+    // per-sample outcome of the current round, and per-sample return of every action
+    vector<double> sample_r(K), sample_V((size_t)K * N), G((size_t)A * K);
+    vector<int> sample_o(K);
+
+    // sums over the samples drawn so far for each action
+    vector<double> R_sum(A, 0.0), obs_count((size_t)A * O, 0.0), V_sum((size_t)A * O * N, 0.0);
+    vector<RunningStat> G_stat(A);
+    vector<int> nb_done(A, 0);
+    vector<bool> racing(A, true), eliminated(A, false);
+    int nb_racing = A;
+
+    // without racing one round draws all samples of an action
+    const int round_size = this->params.action_racing ? max(1, this->params.race_round_size) : K;
+    const int nb_rounds = (K + round_size - 1) / round_size;
+    const double z_race = NormalQuantile(this->params.race_delta / ((double)A * nb_rounds));
+
+    vector<int> &edges = pending.edges;
+    edges.assign((size_t)A * O, -1);
+
+    // R, Q and best successors of action aI from the sums over its samples
+    auto estimate_action = [&](int aI)
+    {
+        const double *V_a_o_n = &V_sum[(size_t)aI * O * N];
+        double Q = R_sum[aI];
+        for (int oI = 0; oI < O; oI++)
+        {
+            if (obs_count[(size_t)aI * O + oI] == 0.0)
+                continue;
+            int nI_a_o = this->FindMaxValueNode(&V_a_o_n[(size_t)oI * N], N);
+            edges[(size_t)aI * O + oI] = nI_a_o;
+            Q += gamma * V_a_o_n[(size_t)oI * N + nI_a_o];
+        }
+        node.R_action[aI] = R_sum[aI] / nb_done[aI];
+        node.Q_action[aI] = Q / nb_done[aI];
+    };
+
+    // With an evaluator, all samples are evaluated elsewhere in ranges of samples_per_job and
+    // only their sums come back, so there is neither racing nor per-sample statistics.
+    bool remote = false;
+    if (this->evaluator && !concurrent)
+    {
+        const int job_size = max(1, this->params.samples_per_job);
+        vector<SampleJob> jobs;
+        for (int aI = 0; aI < A; aI++)
+            for (int i = 0; i < K; i += job_size)
+                jobs.push_back(SampleJob{backup_id, aI, i, min(K, i + job_size), horizon});
+        vector<SampleJobResult> results;
+        const auto deadline = this->budget_active && this->budget_has_deadline
+                                  ? this->budget_deadline
+                                  : chrono::steady_clock::time_point::max();
+        if (this->evaluator->EvaluateSamples(snapshot, versions, belief, jobs, results, deadline))
+        {
+            for (size_t j = 0; j < jobs.size(); j++)
+            {
+                const int aI = jobs[j].aI;
+                const vector<double> &acc = results[j].acc;
+                R_sum[aI] += acc[0];
+                for (int oI = 0; oI < O; oI++)
+                    obs_count[(size_t)aI * O + oI] += acc[1 + oI];
+                for (size_t k = 0; k < (size_t)O * N; k++)
+                    V_sum[(size_t)aI * O * N + k] += acc[1 + O + k];
+                for (int nI = 0; nI < N; nI++)
+                    task_visits[0][nI] += results[j].visits[nI];
+                task_counters[0].nb_sim_calls += results[j].nb_sim_calls;
+            }
+            if (this->budget_active)
+                this->budget_sim_calls += task_counters[0].nb_sim_calls;
+            for (int aI = 0; aI < A; aI++)
+            {
+                nb_done[aI] = K;
+                racing[aI] = false;
+                estimate_action(aI);
+            }
+            nb_racing = 0;
+            remote = true;
+        }
+        else if (!this->budget_active || !this->IsBudgetExhausted())
+        {
+            cerr << "remote sample evaluation failed, evaluating locally" << endl;
+        }
+    }
+
+    for (int round = 0; round < nb_rounds && nb_racing > 0; round++)
+    {
+        for (int aI = 0; aI < A; aI++)
+        {
+            if (!racing[aI])
+                continue;
+            const int i_first = nb_done[aI];
+            const int i_last = min(K, i_first + round_size);
+            const int nb_tasks = max(1, min(max_tasks, i_last - i_first));
+            this->pool.ParallelFor(nb_tasks, [&](int task, int worker)
+                                   {
+                SimInterface *sim = this->worker_sims[worker];
+                BatchedRollout &rollout = this->worker_rollouts[worker];
+                vector<unsigned long> step_seeds(this->params.common_random_numbers ? this->params.L : 0);
+                vector<double> V_tmp(rollout_cache ? N : 0);
+                TaskCounters &counters = task_counters[task];
+                vector<double> &acc = task_acc[task];
+                fill(acc.begin(), acc.end(), 0.0);
+                // acc = [R sum | count per o | V sum per (o, n)]
+                double *obs_n = &acc[1];
+                double *V_o_n = &acc[1 + O];
+                const int i_begin = i_first + (long long)(i_last - i_first) * task / nb_tasks;
+                const int i_end = i_first + (long long)(i_last - i_first) * (task + 1) / nb_tasks;
+                for (int i = i_begin; i < i_end; i++)
+                {
+                    if (this->budget_active && this->IsBudgetExhausted())
+                        break;
+                    const unsigned long nb_sim_calls = counters.nb_sim_calls;
+                    double *V_n = &sample_V[(size_t)i * N];
+                    StoredSample *stored = stored_samples ? &stored_samples[(size_t)aI * K + i] : nullptr;
+                    double r;
+                    int oI;
+                    this->EvaluateSample(policy, belief, backup_id, aI, i, horizon, sim, rollout, stored,
+                                         rollout_cache != nullptr, step_seeds, V_tmp, V_n, r, oI, task_visits[task],
+                                         counters);
+                    acc[0] += r;
+                    obs_n[oI] += 1.0;
+                    sample_r[i] = r;
+                    sample_o[i] = oI;
+                    for (int nI = 0; nI < N; nI++)
+                        V_o_n[(size_t)oI * N + nI] += V_n[nI];
+                    if (this->budget_active)
+                        this->budget_sim_calls += counters.nb_sim_calls - nb_sim_calls;
+                } });
+            // some samples may be missing, the backup is dropped
+            if (this->budget_active && this->budget_exhausted)
+            {
+                pending.aborted = true;
+                return;
+            }
+
+            double *V_a_o_n = &V_sum[(size_t)aI * O * N];
+            for (int task = 0; task < nb_tasks; task++)
+            {
+                const vector<double> &acc = task_acc[task];
+                R_sum[aI] += acc[0];
+                for (int oI = 0; oI < O; oI++)
+                    obs_count[(size_t)aI * O + oI] += acc[1 + oI];
+                for (size_t k = 0; k < (size_t)O * N; k++)
+                    V_a_o_n[k] += acc[1 + O + k];
+            }
+            nb_done[aI] = i_last;
+            estimate_action(aI);
+            // per-sample returns through the successors chosen so far
+            for (int i = i_first; i < i_last; i++)
+            {
+                int nI_a_o = edges[(size_t)aI * O + sample_o[i]];
+                G[(size_t)aI * K + i] = sample_r[i] + gamma * sample_V[(size_t)i * N + nI_a_o];
+                G_stat[aI].Add(G[(size_t)aI * K + i]);
+            }
+            if (nb_done[aI] == K)
+            {
+                racing[aI] = false;
+                nb_racing--;
+            }
+        }
+
+        if (!this->params.action_racing)
+            continue;
+        // drop actions whose upper bound is below the best lower bound
+        double max_lower = -numeric_limits<double>::infinity();
+        for (int aI = 0; aI < A; aI++)
+            if (racing[aI])
+                max_lower = max(max_lower, node.Q_action[aI] - z_race * sqrt(G_stat[aI].GetVariance() / nb_done[aI]));
+        for (int aI = 0; aI < A; aI++)
+        {
+            if (racing[aI] && node.Q_action[aI] + z_race * sqrt(G_stat[aI].GetVariance() / nb_done[aI]) < max_lower)
+            {
+                racing[aI] = false;
+                nb_racing--;
+                eliminated[aI] = true;
+            }
+        }
+        // the remaining action still draws all its samples, its successors need them
+    }
+    if (trajectory_store)
+        trajectory_store->Trim();
+
+    MCVIBackUpStats &stats = pending.stats;
+    stats = MCVIBackUpStats();
+    stats.nb_candidate_nodes = N;
+    stats.rollout_horizon = horizon;
+    stats.rollout_precision_loss = precision_loss;
+    pending.visits.assign(N, 0);
+    for (int task = 0; task < max_tasks; task++)
+    {
+        stats.nb_sim_calls += task_counters[task].nb_sim_calls;
+        stats.nb_steps_saved += task_counters[task].nb_steps_saved;
+        stats.nb_cache_hits += task_counters[task].nb_cache_hits;
+        stats.nb_cache_rollouts += task_counters[task].nb_cache_rollouts;
+        stats.nb_reused_samples += task_counters[task].nb_reused_samples;
+        stats.nb_replayed_steps += task_counters[task].nb_replayed_steps;
+        stats.nb_trajectories_reused += task_counters[task].nb_trajectories_reused;
+        stats.nb_trajectories_resumed += task_counters[task].nb_trajectories_resumed;
+        for (int nI = 0; nI < N; nI++)
+            pending.visits[nI] += task_visits[task][nI];
+    }
+    for (int aI = 0; aI < A; aI++)
+    {
+        stats.nb_samples_used += nb_done[aI];
+        if (eliminated[aI])
+            stats.nb_actions_eliminated++;
+    }
+    stats.nb_samples_saved = (unsigned long)A * K - stats.nb_samples_used;
+
+    // eliminated actions keep their partial estimates but are never chosen
+    node.best_action = -1;
+    for (int aI = 0; aI < A; aI++)
+        if (!eliminated[aI] && (node.best_action < 0 || node.Q_action[aI] > node.Q_action[node.best_action]))
+            node.best_action = aI;
+    node.V_node = node.Q_action[node.best_action];
+    if (!remote)
+        this->ComputeDecisionStats(G, nb_done, node.best_action, stats);
+    stats.backup_value = node.V_node;
+    pending.node = node;
+
+    // the result depends on the nodes the rollouts went through, which are all the nodes
+    // with an action since each one is a candidate successor, and on the successors
+    pending.read_nodes.clear();
+    pending.read_versions.clear();
+    vector<bool> read(N, false);
+    for (int nI = 0; nI < N; nI++)
+        read[nI] = policy.GetAction(nI) >= 0 || pending.visits[nI] > 0;
+    for (int nI_next : edges)
+        if (nI_next >= 0)
+            read[nI_next] = true;
+    for (int nI = 0; nI < N; nI++)
+    {
+        if (!read[nI])
+            continue;
+        pending.read_nodes.push_back(nI);
+        pending.read_versions.push_back(versions[nI]);
+    }
+}
+
+int MCVI::CommitBackUp(const PendingBackUp &pending)
+{
+    const int A = this->fsc.GetSizeOfA();
+    const int O = this->fsc.GetSizeOfObs();
+    const FscNode &node = pending.node;
+    const vector<int> &edges = pending.edges;
+    for (size_t nI = 0; nI < pending.visits.size(); nI++)
+        this->fsc.GetNode(nI).nb_visits += pending.visits[nI];
+
+    // an existing node with the same action and successors executes the same policy
+    const int a_best = node.best_action;
+    for (int nI = 0; nI < this->fsc.GetNodeSize(); nI++)
+    {
+        if (this->fsc.GetBestAction(nI) != a_best)
+            continue;
+        int oI = 0;
+        while (oI < O && this->fsc.GetEtaValue(nI, a_best, oI) == edges[(size_t)a_best * O + oI])
+            oI++;
+        if (oI == O)
+            return nI;
+    }
+
+    // the start node is overwritten until it has been backed up once
+    if (this->fsc.GetBestAction(0) < 0)
+    {
+        this->fsc.GetNode(0) = node;
+        for (int aI = 0; aI < A; aI++)
+            for (int oI = 0; oI < O; oI++)
+                this->fsc.UpdateEta(0, aI, oI, edges[(size_t)aI * O + oI]);
+        this->BumpNodeVersion(0);
+        this->InvalidateCachedValues(0);
+        return 0;
+    }
+    const int nb_nodes = this->fsc.GetNodeSize();
+    const int nI_new = this->fsc.AddNodeBounded(node, edges, this->params.replacement_policy);
+    if (nI_new == nb_nodes)
+    {
+        this->BumpNodeVersion(nI_new);
+    }
+    else
+    {
+        // a replacement redirects edges all over the controller
+        for (int nI = 0; nI < nb_nodes; nI++)
+            this->BumpNodeVersion(nI);
+        if (this->rollout_cache)
+            this->rollout_cache->Clear();
+    }
+    return nI_new;
+}
+
+void MCVI::ComputeDecisionStats(const vector<double> &G, const vector<int> &nb_done, int a_best,
+                                MCVIBackUpStats &stats) const
+{
+    const int A = this->fsc.GetSizeOfA();
+    const int K_stride = this->params.nb_sample;
+    const double z = NormalQuantile(this->params.decision_delta / max(1, A - 1));
+    stats.action_gap = 0.0;
+    stats.action_gap_stddev = 0.0;
+    stats.nb_sample_needed = 0.0;
+    for (int aI = 0; aI < A; aI++)
+    {
+        if (aI == a_best)
+            continue;
+        // pair the samples both actions have drawn
+        const int K = min(nb_done[a_best], nb_done[aI]);
+        double sum = 0.0, sum_sq = 0.0;
+        for (int i = 0; i < K; i++)
+        {
+            double d = G[(size_t)a_best * K_stride + i] - G[(size_t)aI * K_stride + i];
+            sum += d;
+            sum_sq += d * d;
+        }
+        double mean = sum / K;
+        double var = K > 1 ? max(0.0, (sum_sq - K * mean * mean) / (K - 1)) : 0.0;
+        double needed;
+        if (var == 0.0)
+            needed = 1.0;
+        else if (mean <= 0.0)
+            needed = numeric_limits<double>::infinity();
+        else
+            needed = ceil(z * z * var / (mean * mean));
+        if (needed >= stats.nb_sample_needed)
+        {
+            stats.action_gap = mean;
+            stats.action_gap_stddev = sqrt(var);
+            stats.nb_sample_needed = needed;
+        }
+    }
 }
 
-void BackUp(double b, AlphaVectorFSC fsc, int L, int nb_sample, POMDP pomdp){
-    std::vector<int> action_space = pomdp.action_space();
-    std::vector<int> obs_space = pomdp.obs_space();
+void PrintBackUpStats(const MCVIBackUpStats &stats, ostream &os)
+{
+    os << "backup: " << stats.nb_candidate_nodes << " candidate nodes, " << stats.nb_sim_calls
+       << " simulator calls, action gap " << stats.action_gap << " (stddev " << stats.action_gap_stddev
+       << "), samples needed " << stats.nb_sample_needed << ", samples used " << stats.nb_samples_used
+       << " (saved " << stats.nb_samples_saved << ", " << stats.nb_actions_eliminated << " actions eliminated)"
+       << ", rollout horizon " << stats.rollout_horizon << " (precision loss " << stats.rollout_precision_loss
+       << ", " << stats.nb_steps_saved << " steps saved), cache hits " << stats.nb_cache_hits << " (top-up rollouts "
+       << stats.nb_cache_rollouts << "), reused samples " << stats.nb_reused_samples << " (" << stats.nb_replayed_steps
+       << " steps replayed, " << stats.nb_trajectories_reused << " rollouts reused, " << stats.nb_trajectories_resumed
+       << " resumed), load imbalance " << stats.load_imbalance << " (" << stats.nb_steals << " steals), conflicts "
+       << stats.nb_conflicts << " (" << stats.nb_discarded << " discarded)" << endl;
+}
 
-    // TODO: C++ implementation of the`CreatNode` function
+void MCVI::InvalidateCachedValues(int nI)
+{
+    if (!this->rollout_cache)
+        return;
+    // walk the executed edges backwards from nI
+    const int N = this->fsc.GetNodeSize();
+    const int O = this->fsc.GetSizeOfObs();
+    vector<vector<int>> predecessors(N);
+    for (int k = 0; k < N; k++)
+    {
+        int aI = this->fsc.GetBestAction(k);
+        if (aI < 0)
+            continue;
+        for (int oI = 0; oI < O; oI++)
+        {
+            int next = this->fsc.GetEtaValue(k, aI, oI);
+            if (next >= 0 && next != k)
+                predecessors[next].push_back(k);
+        }
+    }
+    vector<bool> reached(N, false);
+    vector<int> stack(1, nI);
+    reached[nI] = true;
+    while (!stack.empty())
+    {
+        int k = stack.back();
+        stack.pop_back();
+        this->rollout_cache->InvalidateNode(k);
+        for (int pred : predecessors[k])
+        {
+            if (!reached[pred])
+            {
+                reached[pred] = true;
+                stack.push_back(pred);
+            }
+        }
+    }
+}
 
-    for (int a =0; a< action_space.size();++a){
-        for (int o =0; o< obs_space.size();++o){
-            for (int nI =0; nI< length(fsc.nodes);++nI){
-                fsc.nodes[nI].V_a_o_n[a][o]=0;
+void MCVI::PromoteToStart(int nI)
+{
+    if (nI == 0)
+        return;
+    unique_lock<shared_mutex> lock(this->fsc_mutex);
+    vector<int> new_index(this->fsc.GetNodeSize());
+    for (int k = 0; k < (int)new_index.size(); k++)
+        new_index[k] = k;
+    new_index[0] = nI;
+    new_index[nI] = 0;
+    this->fsc.Renumber(new_index);
+    // both indices now name another node, and the edges to them were rewritten
+    swap(this->node_versions[0], this->node_versions[nI]);
+    this->BumpNodeVersion(0);
+    this->BumpNodeVersion(nI);
+    const int A = this->fsc.GetSizeOfA();
+    const int O = this->fsc.GetSizeOfObs();
+    for (int k = 0; k < this->fsc.GetNodeSize(); k++)
+    {
+        for (int e = 0; e < A * O; e++)
+        {
+            int next = this->fsc.GetEtaValue(k, e / O, e % O);
+            if (next == 0 || next == nI)
+            {
+                this->BumpNodeVersion(k);
+                break;
             }
         }
     }
+    if (this->rollout_cache)
+        this->rollout_cache->Renumber(new_index);
+    if (this->trajectory_store)
+        this->trajectory_store->Renumber(new_index);
+}
 
-    for (int a =0; a< action_space.size();++a){
-        for (int i =0; i< nb_sample;++i){
-            double s = rand(fsc.nodes[0]._state_particles);
-            std::vector<double> sp, o, r;
-            // TODO: C++ implementation of the`gen` function
+int MCVI::MCVIPlanning(int max_iterations, double epsilon)
+{
+    if (this->b0.empty())
+        this->b0 = this->SampleStartBelief(this->params.nb_particles);
+    if (this->fsc.GetNodeSize() == 0)
+        this->AddStartNode(this->b0);
+
+    int iter = 0;
+    // a resumed run compares with the value the interrupted one ended with
+    double V_start = this->nb_iterations > 0 ? this->last_start_value : this->fsc.GetNode(0).V_node;
+    while (iter < max_iterations)
+    {
+        iter++;
+        this->nb_iterations++;
+        int nI = this->BackUp(this->b0);
+        this->PromoteToStart(nI);
+        if (this->publisher)
+            this->publisher->Publish(this->fsc);
+
+        // a backup matching an existing node keeps that node, use the value just estimated
+        double V_new = this->last_backup_stats.backup_value;
+        this->last_start_value = V_new;
+        if (this->log)
+            *this->log << "iteration " << iter << ": nodes " << this->fsc.GetNodeSize() << ", V(b0) " << V_new;
+        bool converged;
+        if (this->bounds)
+        {
+            // the controller is a lower bound too, the blind policies may still be better;
+            // the backup value overestimates it, so it is evaluated on its own
+            double upper = this->bounds->GetUpperBound(this->b0);
+            double lower = max(this->EvaluateController(this->b0).lower, this->bounds->GetLowerBound(this->b0));
+            this->last_gap = upper - lower;
+            if (this->log)
+                *this->log << ", bounds [" << lower << ", " << upper << "]" << endl;
+            converged = this->last_gap < epsilon;
+        }
+        else
+        {
+            if (this->log)
+                *this->log << endl;
+            converged = this->nb_iterations > 1 && fabs(V_new - V_start) < epsilon;
+        }
+        this->CheckpointIteration();
+        if (converged)
+            break;
+        V_start = V_new;
+    }
+    return iter;
+}
+
+AnytimeResult MCVI::MCVIPlanningAnytime(const AnytimeBudget &budget)
+{
+    const auto t_start = chrono::steady_clock::now();
+    AnytimeResult result;
+    // the budget also covers sampling b0
+    this->budget_has_deadline = budget.time_limit > 0.0;
+    this->budget_deadline = t_start + chrono::duration_cast<chrono::steady_clock::duration>(
+                                          chrono::duration<double>(budget.time_limit));
+    this->budget_max_sim_calls = budget.max_sim_calls;
+    this->budget_sim_calls = 0;
+    this->budget_exhausted = false;
+    this->budget_active = true;
+
+    if (this->b0.empty())
+        this->b0 = this->SampleStartBelief(this->params.nb_particles);
+    if (this->fsc.GetNodeSize() == 0)
+        this->AddStartNode(this->b0);
+    if (this->bounds)
+    {
+        result.upper = this->bounds->GetUpperBound(this->b0);
+        result.lower = this->bounds->GetLowerBound(this->b0);
+    }
+    {
+        // the best controller of earlier runs is still the one to beat
+        lock_guard<mutex> lock(this->checkpoint_mutex);
+        result.lower = max(result.lower, this->anytime_lower);
+    }
+    result.gap = result.upper - result.lower;
+
+    result.stop = AnytimeStop::Iterations;
+    while (budget.max_iterations <= 0 || result.nb_iterations < budget.max_iterations)
+    {
+        if (this->bounds && result.gap < budget.target_gap)
+        {
+            result.stop = AnytimeStop::TargetGap;
+            break;
+        }
+        // the first backup rolls out through a start node without action, its value is not
+        // that of the controller it builds
+        const bool complete = this->fsc.GetBestAction(0) >= 0;
+        int nI = this->BackUp(this->b0);
+        if (nI < 0)
+        {
+            result.stop = this->budget_has_deadline && chrono::steady_clock::now() >= this->budget_deadline
+                              ? AnytimeStop::Deadline
+                              : AnytimeStop::SimCalls;
+            break;
+        }
+        this->PromoteToStart(nI);
+        result.nb_iterations++;
+        this->nb_iterations++;
 
-            fsc.nodes[0]._R_action[a]+= r;
-            for (int nI =0; nI< length(fsc.nodes);++nI){
-                double V_nI = SimulateTrajectory(nI, fsc, sp, L, pomdp);
-                fsc.nodes[nI].V_a_o_n[a][o]+= V_nI;
+        double V_new = this->last_backup_stats.backup_value;
+        this->last_start_value = V_new;
+        if (this->log)
+            *this->log << "iteration " << result.nb_iterations << ": nodes " << this->fsc.GetNodeSize() << ", V(b0) "
+                       << V_new;
+        if (complete)
+        {
+            // the backup value is biased up by the choice of the best action and node, and
+            // a later controller is not always better, so each one is evaluated on its own
+            // the rollouts are charged to the budget as they run; an interrupted evaluation is
+            // dropped and the next backup stops the loop
+            const ControllerEvaluation evaluation = this->EvaluateController(this->b0);
+            if (this->log)
+            {
+                if (evaluation.interrupted)
+                    *this->log << ", evaluation interrupted";
+                else
+                    *this->log << ", evaluated " << evaluation.value << " (lower " << evaluation.lower << ")";
             }
+            bool improved = false;
+            if (!evaluation.interrupted)
+            {
+                lock_guard<mutex> lock(this->checkpoint_mutex);
+                if (evaluation.value > this->anytime_value)
+                {
+                    this->anytime_value = evaluation.value;
+                    this->anytime_lower = evaluation.lower;
+                    this->anytime_fsc = this->fsc;
+                    this->anytime_changed = true;
+                    improved = true;
+                }
+            }
+            if (improved)
+            {
+                result.lower = max(result.lower, evaluation.lower);
+                result.gap = result.upper - result.lower;
+                if (this->publisher)
+                    this->publisher->Publish(this->fsc);
+            }
+        }
+        else
+        {
+            lock_guard<mutex> lock(this->checkpoint_mutex);
+            if (this->anytime_fsc.GetNodeSize() == 0)
+            {
+                this->anytime_fsc = this->fsc;
+                this->anytime_changed = true;
+            }
+        }
+        if (this->log)
+            *this->log << endl;
+        this->last_gap = result.gap;
+        this->CheckpointIteration();
+    }
+
+    this->budget_active = false;
+    {
+        lock_guard<mutex> lock(this->checkpoint_mutex);
+        result.fsc = this->anytime_fsc;
+        result.value = this->anytime_value;
+    }
+    result.nb_sim_calls = this->budget_sim_calls;
+    result.elapsed = chrono::duration<double>(chrono::steady_clock::now() - t_start).count();
+    return result;
+}
+
+const AlphaVectorFSC &MCVI::GetFSC() const
+{
+    return this->fsc;
+}
+
+const vector<int> &MCVI::GetInitBelief() const
+{
+    return this->b0;
+}
+
+unsigned long MCVI::GetNbBackups() const
+{
+    return this->nb_backups;
+}
+
+const MCVIBackUpStats &MCVI::GetLastBackUpStats() const
+{
+    return this->last_backup_stats;
+}
+
+void MCVI::SetBounds(const BoundInterface *bounds)
+{
+    this->bounds = bounds;
+}
+
+double MCVI::GetLastGap() const
+{
+    return this->last_gap;
+}
+
+void MCVI::SetPublisher(PolicyPublisher *publisher)
+{
+    this->publisher = publisher;
+}
+
+void MCVI::SetLog(ostream *log)
+{
+    this->log = log;
+}
+
+void MCVI::SetEvaluator(BackUpEvaluatorInterface *evaluator)
+{
+    this->evaluator = evaluator;
+}
+
+void MCVI::SetExactEvaluator(FscPolicyEvaluator *evaluator)
+{
+    this->exact_evaluator = evaluator;
+}
+
+ControllerEvaluation MCVI::EvaluateController(const vector<int> &belief, int nI)
+{
+    ControllerEvaluation eval;
+    const double gamma = this->sim->GetDiscount();
+    FscPolicyTable snapshot;
+    {
+        shared_lock<shared_mutex> lock(this->fsc_mutex);
+        if (nI >= this->fsc.GetNodeSize() || this->fsc.GetBestAction(nI) < 0 || belief.empty())
+            return eval;
+        if (this->exact_evaluator)
+        {
+            // nodes may have been swapped or renumbered since the last call, no warm start
+            this->exact_evaluator->Reset();
+            this->exact_evaluator->Evaluate(this->fsc);
+            eval.exact = true;
+            eval.value = this->exact_evaluator->GetValue(nI, belief);
+            // distance to the fixed point of a gamma-contraction after a sweep of this residual
+            const double residual = this->exact_evaluator->GetLastResidual();
+            eval.lower = eval.value - (gamma < 1.0 ? residual * gamma / (1.0 - gamma) : residual);
+            return eval;
         }
+        snapshot = FscPolicyTable(this->fsc);
+    }
 
-        for (int o =0; o< obs_space.size();++o){
-            int V_a_o, nI_a_o = FindMaxValueNode(fsc.nodes[0], fsc, a, o);
-            fsc.eta[length(fsc.nodes)][a][o]= nI_a_o;
-            fsc.nodes[length(fsc.nodes)].Q_action[a]+= pomdp.discount()* V_a_o;
+    // reward the rollouts do not see, in the worst case
+    int horizon = this->params.L;
+    double tail = 0.0;
+    if (this->has_reward_bounds && gamma < 1.0)
+    {
+        tail = pow(gamma, horizon) * this->reward_abs_max / (1.0 - gamma);
+        while (tail > this->params.eval_tolerance && horizon < this->params.eval_max_horizon)
+        {
+            tail *= gamma;
+            horizon++;
         }
-        fsc.nodes[0].Q_action[a]/= nb_sample;
     }
 
-    // TODO: C++ implementation of the`GetBestAction` function
+    const FscPolicyView policy = snapshot.GetView();
+    const int R = max(2, this->params.nb_eval_rollouts);
+    const unsigned long evaluation_id = this->nb_evaluations++;
+    const int nb_tasks = max(1, min((int)this->worker_sims.size(), R));
+    vector<double> returns(R);
+    vector<TaskCounters> task_counters(nb_tasks);
+    this->pool.ParallelFor(nb_tasks, [&](int task, int worker)
+                           {
+        SimInterface *sim = this->worker_sims[worker];
+        vector<unsigned long> visits(policy.node_size, 0);
+        TaskCounters &counters = task_counters[task];
+        for (int i = (long long)R * task / nb_tasks; i < (long long)R * (task + 1) / nb_tasks; i++)
+        {
+            if (this->budget_active && this->IsBudgetExhausted())
+                break;
+            const unsigned long nb_sim_calls = counters.nb_sim_calls;
+            // a stream apart from the backups (aI = -2), so the estimate is independent of them
+            const unsigned long seed = SampleSeed(this->params.seed ^ MixSeed(evaluation_id), ~0UL, -2, i);
+            sim->SetSeed(seed);
+            const int sI = belief[MixSeed(seed) % belief.size()];
+            returns[i] = this->SimulateTrajectory(nI, sI, horizon, policy, sim, nullptr, visits, counters);
+            if (this->budget_active)
+                this->budget_sim_calls += counters.nb_sim_calls - nb_sim_calls;
+        } });
+
+    for (const TaskCounters &counters : task_counters)
+        eval.nb_sim_calls += counters.nb_sim_calls;
+    // some rollouts may be missing, the estimate would be biased
+    if (this->budget_active && this->budget_exhausted)
+    {
+        eval.interrupted = true;
+        return eval;
+    }
+    // summed in rollout order, so the result does not depend on the thread count
+    RunningStat stat;
+    for (double G : returns)
+        stat.Add(G);
+    eval.nb_rollouts = R;
+    eval.value = stat.mean;
+    eval.stderr_value = sqrt(stat.GetVariance() / R);
+    eval.lower = eval.value - NormalQuantile(this->params.eval_delta) * eval.stderr_value - tail;
+    return eval;
+}
+
+unsigned long MCVI::GetControllerVersion() const
+{
+    return this->version_clock;
+}
+
+int MCVI::GetNbIterations() const
+{
+    return this->nb_iterations;
 }
 
-void MCVIPlanning(int nb_particles, double b0, AlphaVectorFSC fsc, POMDP pomdp, double epsilon){
-    AlphaVectorFSC node_start = CreatNode(b0, fsc._action_space, fsc._obs_space);
-    fsc.nodes.push_back(node_start);
+void MCVI::SetCheckpoint(CheckpointWriter *writer, int every_iterations)
+{
+    this->checkpoint = writer;
+    this->checkpoint_every = max(1, every_iterations);
+}
+
+void MCVI::CheckpointIteration()
+{
+    if (this->checkpoint && this->nb_iterations % this->checkpoint_every == 0)
+        this->WriteCheckpoint();
+}
 
-    // TODO: C++ implementation of the`CreatNode` function
+// Checkpoint block, version 3:
+//   uint32 version | int32 A, O | uint64 seed | uint64 base_version, version_clock
+//   | uint64 nb_backups, nb_evaluations | int32 nb_iterations
+//   | double last_start_value, last_gap
+//   | stats | uint8 has_b0 [| uint64 size | int32 b0[size]]
+//   | int32 node_size, nb_nodes | nb_nodes x (int32 nI | uint64 version | node)
+//   | int32 nb_visits | nb_visits x (int32 nI | uint64 nb_visits)
+//   | uint8 has_anytime [| double value, lower | int32 node_size | node_size x node]
+// with
+//   node  = int32 best_action | double V_node | uint64 nb_visits | double Q[A], R[A]
+//           | int32 eta[A * O] | uint64 size | CompressBelief() bytes
+//   stats = the fields of MCVIBackUpStats in declaration order, int as int32, unsigned
+//           long as uint64
+// A block applies on top of the state of version base_version. The simulator seeds all
+// come from the seed, nb_backups and nb_evaluations, so these are the positions of the
+// random streams.
+// b0 keeps its particle order, samples pick particles by index. The anytime controller,
+// the best one of MCVIPlanningAnytime(), is only in the blocks where it changed.
+static const uint32_t CHECKPOINT_FORMAT_VERSION = 3;
 
-    while (true){
-        // TODO: C++ implementation of the solver
+static void PutBackUpStats(MessageWriter &out, const MCVIBackUpStats &stats)
+{
+    out.Put((uint64_t)stats.nb_sim_calls);
+    out.Put((int32_t)stats.nb_candidate_nodes);
+    out.Put(stats.backup_value);
+    out.Put(stats.action_gap);
+    out.Put(stats.action_gap_stddev);
+    out.Put(stats.nb_sample_needed);
+    out.Put((uint64_t)stats.nb_samples_used);
+    out.Put((uint64_t)stats.nb_samples_saved);
+    out.Put((int32_t)stats.nb_actions_eliminated);
+    out.Put((int32_t)stats.rollout_horizon);
+    out.Put(stats.rollout_precision_loss);
+    out.Put((uint64_t)stats.nb_steps_saved);
+    out.Put((uint64_t)stats.nb_cache_hits);
+    out.Put((uint64_t)stats.nb_cache_rollouts);
+    out.Put((uint64_t)stats.nb_reused_samples);
+    out.Put((uint64_t)stats.nb_replayed_steps);
+    out.Put((uint64_t)stats.nb_trajectories_reused);
+    out.Put((uint64_t)stats.nb_trajectories_resumed);
+    out.Put(stats.load_imbalance);
+    out.Put((uint64_t)stats.nb_steals);
+    out.Put((int32_t)stats.nb_conflicts);
+    out.Put((int32_t)stats.nb_discarded);
+}
+
+static bool GetBackUpStats(MessageReader &in, MCVIBackUpStats &stats)
+{
+    auto get_u64 = [&](unsigned long &x)
+    {
+        uint64_t v = 0;
+        in.Get(v);
+        x = v;
+    };
+    auto get_i32 = [&](int &x)
+    {
+        int32_t v = 0;
+        in.Get(v);
+        x = v;
+    };
+    get_u64(stats.nb_sim_calls);
+    get_i32(stats.nb_candidate_nodes);
+    in.Get(stats.backup_value);
+    in.Get(stats.action_gap);
+    in.Get(stats.action_gap_stddev);
+    in.Get(stats.nb_sample_needed);
+    get_u64(stats.nb_samples_used);
+    get_u64(stats.nb_samples_saved);
+    get_i32(stats.nb_actions_eliminated);
+    get_i32(stats.rollout_horizon);
+    in.Get(stats.rollout_precision_loss);
+    get_u64(stats.nb_steps_saved);
+    get_u64(stats.nb_cache_hits);
+    get_u64(stats.nb_cache_rollouts);
+    get_u64(stats.nb_reused_samples);
+    get_u64(stats.nb_replayed_steps);
+    get_u64(stats.nb_trajectories_reused);
+    get_u64(stats.nb_trajectories_resumed);
+    in.Get(stats.load_imbalance);
+    get_u64(stats.nb_steals);
+    get_i32(stats.nb_conflicts);
+    get_i32(stats.nb_discarded);
+    return in.ok;
+}
+
+/* node of a checkpoint block, eta[aI * O + oI] are its edges */
+static void PutCheckpointNode(MessageWriter &out, const FscNode &node, const int32_t *eta, int A, int O,
+                              vector<uint8_t> &compressed)
+{
+    out.Put((int32_t)node.best_action);
+    out.Put(node.V_node);
+    out.Put((uint64_t)node.nb_visits);
+    vector<double> Q(node.Q_action), R(node.R_action);
+    Q.resize(A, 0.0);
+    R.resize(A, 0.0);
+    out.PutArray(Q.data(), A);
+    out.PutArray(R.data(), A);
+    out.PutArray(eta, (size_t)A * O);
+    compressed.clear();
+    CompressBelief(node.state_particles, compressed);
+    out.Put((uint64_t)compressed.size());
+    out.PutArray(compressed.data(), compressed.size());
+}
+
+static bool GetCheckpointNode(MessageReader &in, FscNode &node, vector<int32_t> &eta, int A, int O,
+                              vector<uint8_t> &compressed)
+{
+    int32_t best_action;
+    uint64_t nb_visits, size;
+    in.Get(best_action);
+    in.Get(node.V_node);
+    in.Get(nb_visits);
+    node.best_action = best_action;
+    node.nb_visits = nb_visits;
+    node.Q_action.resize(A);
+    node.R_action.resize(A);
+    in.GetArray(node.Q_action.data(), A);
+    in.GetArray(node.R_action.data(), A);
+    eta.resize((size_t)A * O);
+    in.GetArray(eta.data(), eta.size());
+    in.Get(size);
+    if (!in.ok || size > (uint64_t)(in.end - in.p))
+        return false;
+    compressed.resize(size);
+    in.GetArray(compressed.data(), size);
+    return DecompressBelief(compressed.data(), size, node.state_particles);
+}
+
+void MCVI::WriteCheckpoint()
+{
+    if (!this->checkpoint)
+        return;
+    // the checkpoint state changes here, so writers are serialized; the controller is
+    // only read and backups may take snapshots meanwhile
+    lock_guard<mutex> checkpoint_lock(this->checkpoint_mutex);
+    shared_lock<shared_mutex> lock(this->fsc_mutex);
+    const int A = this->fsc.GetSizeOfA();
+    const int O = this->fsc.GetSizeOfObs();
+    const int N = this->fsc.GetNodeSize();
+
+    MessageWriter out;
+    out.Put(CHECKPOINT_FORMAT_VERSION);
+    out.Put((int32_t)A);
+    out.Put((int32_t)O);
+    out.Put((uint64_t)this->params.seed);
+    out.Put((uint64_t)this->checkpoint_version);
+    out.Put((uint64_t)this->version_clock);
+    out.Put((uint64_t)this->nb_backups);
+    out.Put((uint64_t)this->nb_evaluations);
+    out.Put((int32_t)this->nb_iterations);
+    out.Put(this->last_start_value);
+    out.Put(this->last_gap);
+    PutBackUpStats(out, this->last_backup_stats);
+    const bool write_b0 = !this->checkpoint_has_b0 && !this->b0.empty();
+    out.Put((uint8_t)write_b0);
+    if (write_b0)
+    {
+        out.Put((uint64_t)this->b0.size());
+        out.PutArray(this->b0.data(), this->b0.size());
+    }
+
+    // copies of what changed, beliefs are compressed on the writer's thread
+    vector<int> changed;
+    vector<FscNode> changed_nodes;
+    vector<int32_t> changed_eta;
+    for (int nI = 0; nI < N; nI++)
+    {
+        if (this->node_versions[nI] <= this->checkpoint_version)
+            continue;
+        changed.push_back(nI);
+        changed_nodes.push_back(this->fsc.GetNode(nI));
+        for (int aI = 0; aI < A; aI++)
+            for (int oI = 0; oI < O; oI++)
+                changed_eta.push_back(this->fsc.GetEtaValue(nI, aI, oI));
+    }
+    this->checkpoint_visits.resize(N, 0);
+    vector<pair<int32_t, uint64_t>> visits;
+    for (int nI = 0; nI < N; nI++)
+    {
+        const unsigned long nb_visits = this->fsc.GetNode(nI).nb_visits;
+        if (nb_visits != this->checkpoint_visits[nI] && this->node_versions[nI] <= this->checkpoint_version)
+            visits.push_back(make_pair(nI, nb_visits));
+        this->checkpoint_visits[nI] = nb_visits;
     }
+    vector<unsigned long> changed_versions;
+    for (int nI : changed)
+        changed_versions.push_back(this->node_versions[nI]);
+    this->checkpoint_has_b0 = this->checkpoint_has_b0 || write_b0;
+    this->checkpoint_version = this->version_clock;
+    const bool write_anytime = this->anytime_changed;
+    AlphaVectorFSC anytime;
+    if (write_anytime)
+        anytime = this->anytime_fsc;
+    const double anytime_value = this->anytime_value;
+    const double anytime_lower = this->anytime_lower;
+    this->anytime_changed = false;
+
+    this->checkpoint->Append(
+        [out, N, A, O, changed, changed_nodes, changed_eta, changed_versions, visits, write_anytime, anytime,
+         anytime_value, anytime_lower]() mutable
+        {
+            vector<uint8_t> compressed;
+            out.Put((int32_t)N);
+            out.Put((int32_t)changed.size());
+            for (size_t k = 0; k < changed.size(); k++)
+            {
+                out.Put((int32_t)changed[k]);
+                out.Put((uint64_t)changed_versions[k]);
+                PutCheckpointNode(out, changed_nodes[k], &changed_eta[k * A * O], A, O, compressed);
+            }
+            out.Put((int32_t)visits.size());
+            for (const auto &v : visits)
+            {
+                out.Put(v.first);
+                out.Put(v.second);
+            }
+            out.Put((uint8_t)write_anytime);
+            if (write_anytime)
+            {
+                out.Put(anytime_value);
+                out.Put(anytime_lower);
+                out.Put((int32_t)anytime.GetNodeSize());
+                const vector<int> &eta = anytime.GetEta();
+                vector<int32_t> row(eta.begin(), eta.end());
+                for (int nI = 0; nI < anytime.GetNodeSize(); nI++)
+                    PutCheckpointNode(out, anytime.GetNode(nI), &row[(size_t)nI * A * O], A, O, compressed);
+            }
+            return move(out.data);
+        });
+}
+
+bool MCVI::RestoreCheckpoint(const string &filename)
+{
+    if (this->fsc.GetNodeSize() > 0 || this->nb_backups > 0)
+    {
+        cerr << "a checkpoint can only be restored into a new planner" << endl;
+        return false;
+    }
+    vector<vector<uint8_t>> blocks;
+    if (!ReadCheckpointBlocks(filename, blocks))
+        return false;
+    if (blocks.empty())
+    {
+        cerr << "checkpoint " << filename << " is empty" << endl;
+        return false;
+    }
+    const int A = this->fsc.GetSizeOfA();
+    const int O = this->fsc.GetSizeOfObs();
+    lock_guard<mutex> checkpoint_lock(this->checkpoint_mutex);
+    unique_lock<shared_mutex> lock(this->fsc_mutex);
+
+    for (size_t b = 0; b < blocks.size(); b++)
+    {
+        MessageReader in(blocks[b]);
+        uint32_t version;
+        int32_t A_block, O_block, nb_iterations;
+        uint64_t seed, base_version, version_clock, nb_backups, nb_evaluations;
+        in.Get(version);
+        in.Get(A_block);
+        in.Get(O_block);
+        in.Get(seed);
+        in.Get(base_version);
+        in.Get(version_clock);
+        if (!in.ok || version != CHECKPOINT_FORMAT_VERSION || A_block != A || O_block != O ||
+            seed != this->params.seed)
+        {
+            cerr << "checkpoint " << filename << " was written by another planner" << endl;
+            return false;
+        }
+        if (base_version != this->version_clock)
+        {
+            cerr << "checkpoint block " << b << " does not follow the previous one" << endl;
+            return false;
+        }
+        in.Get(nb_backups);
+        in.Get(nb_evaluations);
+        in.Get(nb_iterations);
+        in.Get(this->last_start_value);
+        in.Get(this->last_gap);
+        GetBackUpStats(in, this->last_backup_stats);
+        this->nb_backups = nb_backups;
+        this->nb_evaluations = nb_evaluations;
+        this->nb_iterations = nb_iterations;
+        this->version_clock = version_clock;
+
+        vector<uint8_t> compressed;
+        uint8_t has_b0;
+        in.Get(has_b0);
+        if (has_b0)
+        {
+            uint64_t size;
+            in.Get(size);
+            if (!in.ok || size > (uint64_t)(in.end - in.p) / sizeof(int32_t))
+            {
+                cerr << "bad b0 in checkpoint block " << b << endl;
+                return false;
+            }
+            this->b0.resize(size);
+            in.GetArray(this->b0.data(), size);
+        }
+
+        int32_t N, nb_changed;
+        in.Get(N);
+        in.Get(nb_changed);
+        if (!in.ok || N < this->fsc.GetNodeSize())
+        {
+            cerr << "bad checkpoint block " << b << endl;
+            return false;
+        }
+        while (this->fsc.GetNodeSize() < N)
+            this->fsc.AddNode(FscNode());
+        this->node_versions.resize(N, 0);
+        vector<int32_t> eta((size_t)A * O);
+        for (int k = 0; k < nb_changed; k++)
+        {
+            int32_t nI;
+            uint64_t node_version;
+            in.Get(nI);
+            if (nI < 0 || nI >= N)
+            {
+                cerr << "bad node in checkpoint block " << b << endl;
+                return false;
+            }
+            in.Get(node_version);
+            if (!GetCheckpointNode(in, this->fsc.GetNode(nI), eta, A, O, compressed))
+            {
+                cerr << "bad node belief in checkpoint block " << b << endl;
+                return false;
+            }
+            for (int32_t nI_next : eta)
+            {
+                if (nI_next < -1 || nI_next >= N)
+                {
+                    cerr << "bad edge in checkpoint block " << b << endl;
+                    return false;
+                }
+            }
+            for (int aI = 0; aI < A; aI++)
+                for (int oI = 0; oI < O; oI++)
+                    this->fsc.UpdateEta(nI, aI, oI, eta[(size_t)aI * O + oI]);
+            this->node_versions[nI] = node_version;
+        }
+        int32_t nb_visits;
+        in.Get(nb_visits);
+        for (int k = 0; k < nb_visits && in.ok; k++)
+        {
+            int32_t nI;
+            uint64_t visits;
+            in.Get(nI);
+            in.Get(visits);
+            if (nI >= 0 && nI < N)
+                this->fsc.GetNode(nI).nb_visits = visits;
+        }
+        uint8_t has_anytime;
+        in.Get(has_anytime);
+        if (in.ok && has_anytime)
+        {
+            int32_t anytime_size;
+            in.Get(this->anytime_value);
+            in.Get(this->anytime_lower);
+            in.Get(anytime_size);
+            this->anytime_fsc = AlphaVectorFSC(A, O, this->fsc.GetMaxAcceptBeliefGap());
+            // edges may lead to nodes read after them, they are set once all nodes are in
+            vector<int32_t> anytime_eta;
+            for (int nI = 0; nI < anytime_size && in.ok; nI++)
+            {
+                FscNode node;
+                if (!GetCheckpointNode(in, node, eta, A, O, compressed))
+                {
+                    cerr << "bad anytime node in checkpoint block " << b << endl;
+                    return false;
+                }
+                this->anytime_fsc.AddNode(node);
+                anytime_eta.insert(anytime_eta.end(), eta.begin(), eta.end());
+            }
+            for (size_t e = 0; e < anytime_eta.size(); e++)
+            {
+                if (anytime_eta[e] < -1 || anytime_eta[e] >= anytime_size)
+                {
+                    cerr << "bad anytime edge in checkpoint block " << b << endl;
+                    return false;
+                }
+                const int nI = e / ((size_t)A * O);
+                const int aI = e / O % A;
+                this->anytime_fsc.UpdateEta(nI, aI, e % O, anytime_eta[e]);
+            }
+        }
+        if (!in.ok || in.p != in.end)
+        {
+            cerr << "bad checkpoint block " << b << endl;
+            return false;
+        }
+    }
+
+    // the next blocks continue the file
+    this->anytime_changed = false;
+    this->checkpoint_version = this->version_clock;
+    this->checkpoint_has_b0 = !this->b0.empty();
+    this->checkpoint_visits.resize(this->fsc.GetNodeSize());
+    for (int nI = 0; nI < this->fsc.GetNodeSize(); nI++)
+        this->checkpoint_visits[nI] = this->fsc.GetNode(nI).nb_visits;
+    return true;
 }
@@ -0,0 +1,195 @@
+#include "../include/MCVIWorker.h"
+
+#include <unistd.h>
+
+MCVIWorker::MCVIWorker(SimInterface *sim, const MCVIParameters &params)
+    : sim(sim), params(params), engine(sim, params), A_size(sim->GetSizeOfA()), Obs_size(sim->GetSizeOfObs())
+{
+}
+
+MCVIWorker::~MCVIWorker()
+{
+}
+
+bool MCVIWorker::HandleHello(const vector<uint8_t> &payload, string &error)
+{
+    MessageReader in(payload);
+    uint32_t version;
+    int32_t A, O, L, K;
+    uint64_t seed;
+    uint8_t crn, batched;
+    in.Get(version);
+    in.Get(A);
+    in.Get(O);
+    in.Get(seed);
+    in.Get(L);
+    in.Get(K);
+    in.Get(crn);
+    in.Get(batched);
+    if (!in.ok || version != MCVI_PROTOCOL_VERSION)
+        error = "unsupported protocol version";
+    else if (A != this->A_size || O != this->Obs_size)
+        error = "model sizes differ from the coordinator's";
+    else if (seed != this->params.seed || L != this->params.L || K != this->params.nb_sample ||
+             (bool)crn != this->params.common_random_numbers ||
+             (bool)batched != this->params.batched_rollouts)
+        error = "planner parameters differ from the coordinator's";
+    else
+        return true;
+    return false;
+}
+
+bool MCVIWorker::HandleJob(const vector<uint8_t> &payload, vector<uint8_t> &reply, string &error)
+{
+    const int AO = this->A_size * this->Obs_size;
+    MessageReader in(payload);
+    uint64_t backup_id, base_version, new_version;
+    int32_t aI, i_begin, i_end, horizon, N, nb_changed;
+    in.Get(backup_id);
+    in.Get(aI);
+    in.Get(i_begin);
+    in.Get(i_end);
+    in.Get(horizon);
+    in.Get(base_version);
+    in.Get(new_version);
+    in.Get(N);
+    in.Get(nb_changed);
+    if (!in.ok || base_version != this->controller_version || N < 0 || nb_changed < 0 || aI < 0 ||
+        aI >= this->A_size)
+    {
+        error = "job does not match the controller replica";
+        return false;
+    }
+    if (i_begin < 0 || i_begin > i_end || i_end > this->params.nb_sample || horizon < 0 ||
+        horizon > this->params.L)
+    {
+        error = "sample range or horizon out of range";
+        return false;
+    }
+
+    // bring the replica to new_version; actions must be in [-1, A) and eta in [-1, N)
+    this->actions.resize(N, -1);
+    this->eta.resize((size_t)N * AO, -1);
+    for (int k = 0; k < nb_changed; k++)
+    {
+        int32_t nI;
+        in.Get(nI);
+        if (!in.ok || nI < 0 || nI >= N)
+        {
+            error = "changed node out of range";
+            return false;
+        }
+        in.Get(this->actions[nI]);
+        in.GetArray(&this->eta[(size_t)nI * AO], AO);
+        if (!in.ok || this->actions[nI] < -1 || this->actions[nI] >= this->A_size)
+        {
+            error = "action out of range";
+            return false;
+        }
+        for (int j = 0; j < AO; j++)
+            if (this->eta[(size_t)nI * AO + j] < -1 || this->eta[(size_t)nI * AO + j] >= N)
+            {
+                error = "edge out of range";
+                return false;
+            }
+    }
+    // unchanged nodes may still point to nodes the controller no longer has
+    if (N < this->node_size)
+        for (int32_t n_next : this->eta)
+            if (n_next >= N)
+            {
+                error = "edge out of range";
+                return false;
+            }
+    this->node_size = N;
+    this->controller_version = new_version;
+
+    uint8_t has_belief;
+    in.Get(has_belief);
+    if (has_belief)
+    {
+        uint64_t size;
+        in.Get(size);
+        if (!in.ok || size > (uint64_t)(in.end - in.p) / sizeof(int32_t))
+        {
+            error = "bad belief";
+            return false;
+        }
+        this->belief.resize(size);
+        in.GetArray(this->belief.data(), size);
+        this->belief_backup_id = backup_id;
+        this->has_belief = true;
+    }
+    if (!in.ok || !this->has_belief || this->belief_backup_id != backup_id || this->belief.empty())
+    {
+        error = "job without the belief of its backup";
+        return false;
+    }
+
+    const FscPolicyView policy =
+        MakeFscPolicyView(this->actions.data(), this->eta.data(), N, this->A_size, this->Obs_size);
+    vector<double> acc;
+    vector<unsigned long> visits;
+    uint64_t nb_sim_calls =
+        this->engine.EvaluateSamples(policy, this->belief, backup_id, aI, i_begin, i_end, horizon, acc, visits);
+    this->nb_jobs++;
+
+    MessageWriter out;
+    out.Put(nb_sim_calls);
+    out.Put(N);
+    out.PutArray(acc.data(), acc.size());
+    for (unsigned long v : visits)
+        out.Put((uint64_t)v);
+    reply.swap(out.data);
+    return true;
+}
+
+bool MCVIWorker::Serve(const string &address)
+{
+    int listen_fd = MessageChannel::Listen(address);
+    if (listen_fd < 0)
+        return false;
+    MessageChannel channel;
+    bool ok = channel.Accept(listen_fd);
+    close(listen_fd);
+    if (!ok)
+        return false;
+
+    bool greeted = false;
+    uint32_t type;
+    vector<uint8_t> payload, reply;
+    while (channel.Receive(type, payload))
+    {
+        string error;
+        if (type == MSG_SHUTDOWN)
+            return true;
+        if (type == MSG_HELLO)
+        {
+            greeted = this->HandleHello(payload, error);
+            if (greeted && !channel.Send(MSG_HELLO_OK, vector<uint8_t>()))
+                return false;
+        }
+        else if (type == MSG_JOB && greeted)
+        {
+            if (this->HandleJob(payload, reply, error) && !channel.Send(MSG_RESULT, reply))
+                return false;
+        }
+        else
+        {
+            error = "unexpected message";
+        }
+        if (!error.empty())
+        {
+            cerr << "worker: " << error << endl;
+            channel.Send(MSG_ERROR, vector<uint8_t>(error.begin(), error.end()));
+            return false;
+        }
+    }
+    // the coordinator went away without a shutdown
+    return false;
+}
+
+unsigned long MCVIWorker::GetNbJobs() const
+{
+    return this->nb_jobs;
+}
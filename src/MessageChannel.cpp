@@ -0,0 +1,205 @@
+#include "../include/MessageChannel.h"
+
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+struct MessageHeader
+{
+    uint32_t type;
+    uint32_t reserved;
+    uint64_t size;
+};
+
+// largest payload accepted, guards against a corrupted header
+static const uint64_t MAX_MESSAGE_SIZE = 1ULL << 32;
+
+/* socket address of "unix:<path>" or "tcp:<host>:<port>", false if it cannot be resolved */
+static bool ResolveAddress(const string &address, sockaddr_storage &addr, socklen_t &len, int &family)
+{
+    memset(&addr, 0, sizeof(addr));
+    if (address.compare(0, 5, "unix:") == 0)
+    {
+        const string path = address.substr(5);
+        sockaddr_un *un = reinterpret_cast<sockaddr_un *>(&addr);
+        if (path.empty() || path.size() >= sizeof(un->sun_path))
+            return false;
+        un->sun_family = AF_UNIX;
+        memcpy(un->sun_path, path.c_str(), path.size() + 1);
+        len = sizeof(sockaddr_un);
+        family = AF_UNIX;
+        return true;
+    }
+    if (address.compare(0, 4, "tcp:") == 0)
+    {
+        const string rest = address.substr(4);
+        size_t colon = rest.rfind(':');
+        if (colon == string::npos)
+            return false;
+        addrinfo hints;
+        memset(&hints, 0, sizeof(hints));
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        addrinfo *res = nullptr;
+        if (getaddrinfo(rest.substr(0, colon).c_str(), rest.substr(colon + 1).c_str(), &hints, &res) != 0 || !res)
+            return false;
+        memcpy(&addr, res->ai_addr, res->ai_addrlen);
+        len = res->ai_addrlen;
+        family = res->ai_family;
+        freeaddrinfo(res);
+        return true;
+    }
+    return false;
+}
+
+static bool WriteAll(int fd, const void *data, size_t size)
+{
+    const uint8_t *p = static_cast<const uint8_t *>(data);
+    while (size > 0)
+    {
+        ssize_t n = send(fd, p, size, MSG_NOSIGNAL);
+        if (n <= 0)
+            return false;
+        p += n;
+        size -= n;
+    }
+    return true;
+}
+
+static bool ReadAll(int fd, void *data, size_t size)
+{
+    uint8_t *p = static_cast<uint8_t *>(data);
+    while (size > 0)
+    {
+        ssize_t n = recv(fd, p, size, 0);
+        if (n <= 0)
+            return false;
+        p += n;
+        size -= n;
+    }
+    return true;
+}
+
+MessageChannel::~MessageChannel()
+{
+    this->Close();
+}
+
+int MessageChannel::Listen(const string &address)
+{
+    sockaddr_storage addr;
+    socklen_t len;
+    int family;
+    if (!ResolveAddress(address, addr, len, family))
+    {
+        cerr << "cannot resolve address " << address << endl;
+        return -1;
+    }
+    int fd = socket(family, SOCK_STREAM, 0);
+    if (fd < 0)
+        return -1;
+    if (family == AF_UNIX)
+        unlink(reinterpret_cast<sockaddr_un *>(&addr)->sun_path);
+    else
+    {
+        int one = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    }
+    if (bind(fd, reinterpret_cast<sockaddr *>(&addr), len) != 0 || listen(fd, 16) != 0)
+    {
+        cerr << "cannot listen on " << address << endl;
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+bool MessageChannel::Accept(int listen_fd)
+{
+    this->Close();
+    this->fd = accept(listen_fd, nullptr, nullptr);
+    if (this->fd < 0)
+        return false;
+    int one = 1;
+    setsockopt(this->fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    return true;
+}
+
+bool MessageChannel::Connect(const string &address, double timeout)
+{
+    this->Close();
+    sockaddr_storage addr;
+    socklen_t len;
+    int family;
+    if (!ResolveAddress(address, addr, len, family))
+    {
+        cerr << "cannot resolve address " << address << endl;
+        return false;
+    }
+    // the worker may still be starting up
+    auto deadline = chrono::steady_clock::now() + chrono::duration<double>(timeout);
+    while (true)
+    {
+        this->fd = socket(family, SOCK_STREAM, 0);
+        if (this->fd < 0)
+            return false;
+        if (connect(this->fd, reinterpret_cast<sockaddr *>(&addr), len) == 0)
+            break;
+        this->Close();
+        if (chrono::steady_clock::now() >= deadline)
+        {
+            cerr << "cannot connect to " << address << endl;
+            return false;
+        }
+        this_thread::sleep_for(chrono::milliseconds(20));
+    }
+    if (family != AF_UNIX)
+    {
+        int one = 1;
+        setsockopt(this->fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    }
+    return true;
+}
+
+bool MessageChannel::Send(uint32_t type, const vector<uint8_t> &payload)
+{
+    if (this->fd < 0)
+        return false;
+    MessageHeader header = {type, 0, payload.size()};
+    return WriteAll(this->fd, &header, sizeof(header)) && WriteAll(this->fd, payload.data(), payload.size());
+}
+
+bool MessageChannel::Receive(uint32_t &type, vector<uint8_t> &payload)
+{
+    if (this->fd < 0)
+        return false;
+    MessageHeader header;
+    if (!ReadAll(this->fd, &header, sizeof(header)) || header.size > MAX_MESSAGE_SIZE)
+        return false;
+    type = header.type;
+    payload.resize(header.size);
+    return ReadAll(this->fd, payload.data(), payload.size());
+}
+
+void MessageChannel::Close()
+{
+    if (this->fd >= 0)
+        close(this->fd);
+    this->fd = -1;
+}
+
+bool MessageChannel::IsOpen() const
+{
+    return this->fd >= 0;
+}
+
+int MessageChannel::GetFd() const
+{
+    return this->fd;
+}
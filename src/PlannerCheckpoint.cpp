@@ -0,0 +1,207 @@
+#include "../include/PlannerCheckpoint.h"
+
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <unistd.h>
+
+struct CheckpointBlockHeader
+{
+    uint32_t magic;
+    uint32_t reserved;
+    uint64_t size;
+    uint64_t checksum;
+};
+
+/* FNV-1a over the payload */
+static uint64_t Checksum(const uint8_t *data, size_t size)
+{
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < size; i++)
+        h = (h ^ data[i]) * 0x100000001b3ULL;
+    return h;
+}
+
+static bool WriteAll(int fd, const void *data, size_t size)
+{
+    const uint8_t *p = static_cast<const uint8_t *>(data);
+    while (size > 0)
+    {
+        ssize_t n = write(fd, p, size);
+        if (n <= 0)
+            return false;
+        p += n;
+        size -= n;
+    }
+    return true;
+}
+
+/* whole content of filename, false if it cannot be read */
+static bool ReadFile(const string &filename, vector<uint8_t> &data)
+{
+    data.clear();
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+    uint8_t buffer[1 << 16];
+    ssize_t n;
+    while ((n = read(fd, buffer, sizeof(buffer))) > 0)
+        data.insert(data.end(), buffer, buffer + n);
+    close(fd);
+    return n == 0;
+}
+
+/* payloads of the valid blocks of data (if blocks is set), returns the size they span */
+static size_t ParseBlocks(const vector<uint8_t> &data, vector<vector<uint8_t>> *blocks)
+{
+    size_t pos = 0;
+    while (data.size() - pos >= sizeof(CheckpointBlockHeader))
+    {
+        CheckpointBlockHeader header;
+        memcpy(&header, &data[pos], sizeof(header));
+        const size_t payload = pos + sizeof(header);
+        if (header.magic != CHECKPOINT_BLOCK_MAGIC || header.size > data.size() - payload ||
+            Checksum(&data[payload], header.size) != header.checksum)
+            break;
+        if (blocks)
+            blocks->emplace_back(data.begin() + payload, data.begin() + payload + header.size);
+        pos = payload + header.size;
+    }
+    return pos;
+}
+
+CheckpointWriter::~CheckpointWriter()
+{
+    this->Close();
+}
+
+bool CheckpointWriter::Open(const string &filename)
+{
+    this->Close();
+    this->fd = open(filename.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (this->fd < 0)
+    {
+        cerr << "cannot open checkpoint file " << filename << endl;
+        return false;
+    }
+    // drop a block left incomplete by a crash, the reader would stop at it
+    vector<uint8_t> data;
+    if (!ReadFile(filename, data))
+    {
+        close(this->fd);
+        this->fd = -1;
+        return false;
+    }
+    const size_t valid_size = ParseBlocks(data, nullptr);
+    if (valid_size < data.size() && ftruncate(this->fd, valid_size) != 0)
+    {
+        cerr << "cannot truncate the damaged end of " << filename << endl;
+        close(this->fd);
+        this->fd = -1;
+        return false;
+    }
+    this->stopping = false;
+    this->failed = false;
+    this->worker = thread(&CheckpointWriter::Run, this);
+    return true;
+}
+
+void CheckpointWriter::Close()
+{
+    if (this->fd < 0)
+        return;
+    {
+        lock_guard<mutex> lock(this->queue_mutex);
+        this->stopping = true;
+    }
+    this->queue_cv.notify_all();
+    this->worker.join();
+    close(this->fd);
+    this->fd = -1;
+}
+
+void CheckpointWriter::Append(function<vector<uint8_t>()> encode)
+{
+    {
+        lock_guard<mutex> lock(this->queue_mutex);
+        this->queue.push_back(move(encode));
+    }
+    this->queue_cv.notify_one();
+}
+
+void CheckpointWriter::Run()
+{
+    unique_lock<mutex> lock(this->queue_mutex);
+    while (true)
+    {
+        this->queue_cv.wait(lock, [this]
+                            { return this->stopping || !this->queue.empty(); });
+        if (this->queue.empty())
+            return;
+        function<vector<uint8_t>()> encode = move(this->queue.front());
+        this->queue.pop_front();
+        this->busy = true;
+        lock.unlock();
+
+        vector<uint8_t> payload = encode();
+        CheckpointBlockHeader header = {CHECKPOINT_BLOCK_MAGIC, 0, payload.size(),
+                                        Checksum(payload.data(), payload.size())};
+        // a block only counts once it is on disk
+        bool ok = WriteAll(this->fd, &header, sizeof(header)) && WriteAll(this->fd, payload.data(), payload.size()) &&
+                  fdatasync(this->fd) == 0;
+
+        lock.lock();
+        this->busy = false;
+        if (ok)
+        {
+            this->nb_blocks++;
+            this->nb_bytes += sizeof(header) + payload.size();
+        }
+        else if (!this->failed)
+        {
+            cerr << "checkpoint write failed" << endl;
+            this->failed = true;
+        }
+        this->idle_cv.notify_all();
+    }
+}
+
+bool CheckpointWriter::Flush()
+{
+    unique_lock<mutex> lock(this->queue_mutex);
+    this->idle_cv.wait(lock, [this]
+                       { return this->fd < 0 || (this->queue.empty() && !this->busy); });
+    return !this->failed;
+}
+
+bool CheckpointWriter::HasFailed()
+{
+    lock_guard<mutex> lock(this->queue_mutex);
+    return this->failed;
+}
+
+unsigned long CheckpointWriter::GetNbBlocks()
+{
+    lock_guard<mutex> lock(this->queue_mutex);
+    return this->nb_blocks;
+}
+
+unsigned long CheckpointWriter::GetNbBytes()
+{
+    lock_guard<mutex> lock(this->queue_mutex);
+    return this->nb_bytes;
+}
+
+bool ReadCheckpointBlocks(const string &filename, vector<vector<uint8_t>> &blocks)
+{
+    blocks.clear();
+    vector<uint8_t> data;
+    if (!ReadFile(filename, data))
+    {
+        cerr << "cannot read checkpoint file " << filename << endl;
+        return false;
+    }
+    if (ParseBlocks(data, &blocks) < data.size())
+        cerr << "checkpoint " << filename << " ends with a damaged block, ignored" << endl;
+    return true;
+}
@@ -0,0 +1,100 @@
+#include "../include/PolicyPublisher.h"
+
+PolicyPublisher::~PolicyPublisher()
+{
+    // readers are expected to be gone
+    delete this->current.load();
+    for (auto &it : this->retired)
+        delete it.first;
+}
+
+uint64_t PolicyPublisher::Publish(const AlphaVectorFSC &fsc)
+{
+    PolicySnapshot *snapshot = new PolicySnapshot;
+    snapshot->table = FscPolicyTable(fsc);
+    snapshot->start_value = fsc.GetNodeSize() > 0 ? fsc.GetNode(0).V_node : 0.0;
+    return this->Publish(snapshot);
+}
+
+uint64_t PolicyPublisher::Publish(PolicySnapshot *snapshot)
+{
+    uint64_t version;
+    {
+        lock_guard<mutex> lock(this->retired_mutex);
+        version = this->next_version++;
+        snapshot->version = version;
+        const PolicySnapshot *old = this->current.exchange(snapshot);
+        // readers that may still hold old entered at an epoch <= retire_epoch
+        uint64_t retire_epoch = this->global_epoch.fetch_add(1);
+        if (old)
+            this->retired.push_back(make_pair(old, retire_epoch));
+    }
+    this->Reclaim();
+    return version;
+}
+
+int PolicyPublisher::Reclaim()
+{
+    // scan under the lock, so that nothing is retired between the scan and the frees
+    lock_guard<mutex> lock(this->retired_mutex);
+    uint64_t min_active = UINT64_MAX;
+    for (int i = 0; i < MAX_READERS; i++)
+    {
+        uint64_t e = this->readers[i].epoch.load();
+        if (e != 0 && e < min_active)
+            min_active = e;
+    }
+
+    int nb_freed = 0;
+    size_t kept = 0;
+    for (size_t i = 0; i < this->retired.size(); i++)
+    {
+        if (this->retired[i].second < min_active)
+        {
+            delete this->retired[i].first;
+            nb_freed++;
+        }
+        else
+        {
+            this->retired[kept++] = this->retired[i];
+        }
+    }
+    this->retired.resize(kept);
+    return nb_freed;
+}
+
+int PolicyPublisher::GetNbRetired()
+{
+    lock_guard<mutex> lock(this->retired_mutex);
+    return this->retired.size();
+}
+
+int PolicyPublisher::RegisterReader()
+{
+    for (int i = 0; i < MAX_READERS; i++)
+    {
+        bool expected = false;
+        if (this->readers[i].in_use.compare_exchange_strong(expected, true))
+            return i;
+    }
+    return -1;
+}
+
+void PolicyPublisher::UnregisterReader(int reader_id)
+{
+    this->readers[reader_id].epoch.store(0);
+    this->readers[reader_id].in_use.store(false);
+}
+
+const PolicySnapshot *PolicyPublisher::BeginRead(int reader_id)
+{
+    // announce the epoch before loading, both sequentially consistent so that the
+    // publisher's scan in Reclaim sees the announcement of any reader holding old
+    this->readers[reader_id].epoch.store(this->global_epoch.load());
+    return this->current.load();
+}
+
+void PolicyPublisher::EndRead(int reader_id)
+{
+    this->readers[reader_id].epoch.store(0, memory_order_release);
+}
@@ -0,0 +1,224 @@
+#include "../include/PomdpBounds.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+PomdpBounds::PomdpBounds(const PomdpInterface *pomdp, int nb_threads)
+    : pomdp(pomdp), S_size(pomdp->GetSizeOfS()), A_size(pomdp->GetSizeOfA()), discount(pomdp->GetDiscount()),
+      pool(max(1, nb_threads))
+{
+    this->BuildSparseModel();
+
+    const int S = this->S_size;
+    const int A = this->A_size;
+    double r_min = 0.0, r_max = 0.0;
+    if (!this->rewards.empty())
+    {
+        r_min = *min_element(this->rewards.begin(), this->rewards.end());
+        r_max = *max_element(this->rewards.begin(), this->rewards.end());
+    }
+    // undiscounted models start from 0, the bounds are then only valid once converged
+    const double horizon = this->discount < 1.0 ? 1.0 / (1.0 - this->discount) : 0.0;
+    this->V_upper.assign(S, r_max * horizon);
+    this->Q_upper.assign((size_t)A * S, r_max * horizon);
+    this->W_lower.assign((size_t)A * S, r_min * horizon);
+}
+
+PomdpBounds::~PomdpBounds()
+{
+}
+
+/* flatten T into CSR rows and R into an action-major table */
+void PomdpBounds::BuildSparseModel()
+{
+    const int S = this->S_size;
+    this->trans_start.assign(1, 0);
+    this->rewards.resize((size_t)this->A_size * S);
+    for (int aI = 0; aI < this->A_size; aI++)
+    {
+        for (int sI = 0; sI < S; sI++)
+        {
+            const map<int, double> *trans = this->pomdp->GetTransProbDist(sI, aI);
+            if (trans)
+            {
+                for (const auto &it : *trans)
+                {
+                    if (it.second > 0.0)
+                    {
+                        this->trans_state.push_back(it.first);
+                        this->trans_prob.push_back(it.second);
+                    }
+                }
+            }
+            else
+            {
+                for (int s_newI = 0; s_newI < S; s_newI++)
+                {
+                    double p = this->pomdp->TransFunc(sI, aI, s_newI);
+                    if (p > 0.0)
+                    {
+                        this->trans_state.push_back(s_newI);
+                        this->trans_prob.push_back(p);
+                    }
+                }
+            }
+            this->trans_start.push_back(this->trans_state.size());
+            this->rewards[(size_t)aI * S + sI] = this->pomdp->Reward(sI, aI);
+        }
+    }
+}
+
+double PomdpBounds::Sweep(int s_begin, int s_end, const vector<double> &V_prev, const vector<double> &W_prev)
+{
+    const int S = this->S_size;
+    const int *state = this->trans_state.data();
+    const double *prob = this->trans_prob.data();
+    double residual = 0.0;
+    for (int aI = 0; aI < this->A_size; aI++)
+    {
+        const double *W_a = &W_prev[(size_t)aI * S];
+        for (int sI = s_begin; sI < s_end; sI++)
+        {
+            const size_t row = (size_t)aI * S + sI;
+            // both bounds share the row, plain gather loops the compiler can vectorize
+            double future_V = 0.0, future_W = 0.0;
+            for (int t = this->trans_start[row]; t < this->trans_start[row + 1]; t++)
+            {
+                future_V += prob[t] * V_prev[state[t]];
+                future_W += prob[t] * W_a[state[t]];
+            }
+            this->Q_upper[row] = this->rewards[row] + this->discount * future_V;
+            double w = this->rewards[row] + this->discount * future_W;
+            residual = max(residual, fabs(w - this->W_lower[row]));
+            this->W_lower[row] = w;
+        }
+    }
+    for (int sI = s_begin; sI < s_end; sI++)
+    {
+        double v = -numeric_limits<double>::infinity();
+        for (int aI = 0; aI < this->A_size; aI++)
+            v = max(v, this->Q_upper[(size_t)aI * S + sI]);
+        residual = max(residual, fabs(v - this->V_upper[sI]));
+        this->V_upper[sI] = v;
+    }
+    return residual;
+}
+
+int PomdpBounds::Compute(double tolerance, int max_iterations)
+{
+    const int S = this->S_size;
+    const int nb_blocks = max(1, min(this->pool.GetNbThreads(), S));
+    vector<double> V_prev, W_prev;
+    vector<double> block_residual(nb_blocks);
+    int iter = 0;
+    double residual = 0.0;
+    for (iter = 1; iter <= max_iterations; iter++)
+    {
+        V_prev = this->V_upper;
+        W_prev = this->W_lower;
+        this->pool.ParallelFor(nb_blocks, [&](int b, int)
+                               {
+            int s_begin = (long long)S * b / nb_blocks;
+            int s_end = (long long)S * (b + 1) / nb_blocks;
+            block_residual[b] = this->Sweep(s_begin, s_end, V_prev, W_prev); });
+        residual = *max_element(block_residual.begin(), block_residual.end());
+        if (residual < tolerance)
+            break;
+    }
+
+    this->last_iterations = min(iter, max_iterations);
+    this->last_residual = residual;
+    return this->last_iterations;
+}
+
+int PomdpBounds::GetLastIterations() const
+{
+    return this->last_iterations;
+}
+
+double PomdpBounds::GetLastResidual() const
+{
+    return this->last_residual;
+}
+
+double PomdpBounds::GetUpperBound(const vector<int> &particles) const
+{
+    const int S = this->S_size;
+    double best = -numeric_limits<double>::infinity();
+    for (int aI = 0; aI < this->A_size; aI++)
+    {
+        const double *Q_a = &this->Q_upper[(size_t)aI * S];
+        double sum = 0.0;
+        for (int sI : particles)
+            sum += Q_a[sI];
+        best = max(best, sum);
+    }
+    return particles.empty() ? 0.0 : best / particles.size();
+}
+
+double PomdpBounds::GetMDPUpperBound(const vector<int> &particles) const
+{
+    double sum = 0.0;
+    for (int sI : particles)
+        sum += this->V_upper[sI];
+    return particles.empty() ? 0.0 : sum / particles.size();
+}
+
+double PomdpBounds::GetLowerBound(const vector<int> &particles) const
+{
+    const int S = this->S_size;
+    double best = -numeric_limits<double>::infinity();
+    for (int aI = 0; aI < this->A_size; aI++)
+    {
+        const double *W_a = &this->W_lower[(size_t)aI * S];
+        double sum = 0.0;
+        for (int sI : particles)
+            sum += W_a[sI];
+        best = max(best, sum);
+    }
+    return particles.empty() ? 0.0 : best / particles.size();
+}
+
+double PomdpBounds::GetUpperBound(const map<int, double> &belief) const
+{
+    const int S = this->S_size;
+    double best = -numeric_limits<double>::infinity();
+    for (int aI = 0; aI < this->A_size; aI++)
+    {
+        double sum = 0.0;
+        for (const auto &it : belief)
+            sum += it.second * this->Q_upper[(size_t)aI * S + it.first];
+        best = max(best, sum);
+    }
+    return best;
+}
+
+double PomdpBounds::GetLowerBound(const map<int, double> &belief) const
+{
+    const int S = this->S_size;
+    double best = -numeric_limits<double>::infinity();
+    for (int aI = 0; aI < this->A_size; aI++)
+    {
+        double sum = 0.0;
+        for (const auto &it : belief)
+            sum += it.second * this->W_lower[(size_t)aI * S + it.first];
+        best = max(best, sum);
+    }
+    return best;
+}
+
+const vector<double> &PomdpBounds::GetMDPValues() const
+{
+    return this->V_upper;
+}
+
+const vector<double> &PomdpBounds::GetQMDPValues() const
+{
+    return this->Q_upper;
+}
+
+const vector<double> &PomdpBounds::GetBlindValues() const
+{
+    return this->W_lower;
+}
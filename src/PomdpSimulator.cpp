@@ -0,0 +1,164 @@
+#include "../include/PomdpSimulator.h"
+
+#include <algorithm>
+
+PomdpSimulator::PomdpSimulator(const PomdpInterface *pomdp, unsigned long seed)
+    : pomdp(pomdp), rng(seed), r_min(0.0), r_max(0.0)
+{
+    for (int sI = 0; sI < pomdp->GetSizeOfS(); sI++)
+    {
+        for (int aI = 0; aI < pomdp->GetSizeOfA(); aI++)
+        {
+            double r = pomdp->Reward(sI, aI);
+            if ((sI == 0 && aI == 0) || r < this->r_min)
+                this->r_min = r;
+            if ((sI == 0 && aI == 0) || r > this->r_max)
+                this->r_max = r;
+        }
+    }
+
+    const int S = pomdp->GetSizeOfS();
+    const int A = pomdp->GetSizeOfA();
+    const int O = pomdp->GetSizeOfObs();
+    // a model may give sparse rows for some pairs only, Step() needs the others
+    bool dense_trans = false, dense_obs = false;
+    for (int sI = 0; sI < S; sI++)
+        for (int aI = 0; aI < A; aI++)
+        {
+            dense_trans = dense_trans || !pomdp->GetTransProbDist(sI, aI);
+            dense_obs = dense_obs || !pomdp->GetObsFuncProbDist(sI, aI);
+        }
+    if (dense_trans)
+    {
+        auto cdf = make_shared<vector<double>>((size_t)S * A * S);
+        for (int sI = 0; sI < S; sI++)
+            for (int aI = 0; aI < A; aI++)
+            {
+                double *row = cdf->data() + ((size_t)sI * A + aI) * S;
+                double sum = 0.0;
+                for (int s_newI = 0; s_newI < S; s_newI++)
+                    row[s_newI] = sum += max(0.0, pomdp->TransFunc(sI, aI, s_newI));
+            }
+        this->trans_cdf = cdf;
+    }
+    if (dense_obs && O > 0)
+    {
+        auto cdf = make_shared<vector<double>>((size_t)S * A * O);
+        for (int s_newI = 0; s_newI < S; s_newI++)
+            for (int aI = 0; aI < A; aI++)
+            {
+                double *row = cdf->data() + ((size_t)s_newI * A + aI) * O;
+                double sum = 0.0;
+                for (int oI = 0; oI < O; oI++)
+                    row[oI] = sum += max(0.0, pomdp->ObsFunc(oI, s_newI, aI));
+            }
+        this->obs_cdf = cdf;
+    }
+}
+
+PomdpSimulator::~PomdpSimulator()
+{
+}
+
+/* sample an index from a sparse distribution, the last entry absorbs rounding errors */
+int PomdpSimulator::SampleFrom(const map<int, double> &dist)
+{
+    double u = uniform_real_distribution<double>(0.0, 1.0)(this->rng);
+    int last = -1;
+    for (const auto &it : dist)
+    {
+        if (it.second <= 0.0)
+            continue;
+        last = it.first;
+        if (u < it.second)
+            return it.first;
+        u -= it.second;
+    }
+    return last;
+}
+
+/* sample an index from a cumulative row, scaled by its total so that rounding errors
+ * cannot run past the last entry with a positive probability */
+int PomdpSimulator::SampleFromCdf(const double *cdf, int size)
+{
+    const double total = cdf[size - 1];
+    if (total <= 0.0)
+        return -1;
+    double u = uniform_real_distribution<double>(0.0, 1.0)(this->rng) * total;
+    return min((int)(upper_bound(cdf, cdf + size, u) - cdf), size - 1);
+}
+
+/* sample s' from T(s, a, .), o from O(a, s', .), and return R(s, a); never done */
+tuple<int, int, double, bool> PomdpSimulator::Step(int sI, int aI)
+{
+    int s_newI;
+    const map<int, double> *trans = this->pomdp->GetTransProbDist(sI, aI);
+    if (trans)
+    {
+        s_newI = this->SampleFrom(*trans);
+    }
+    else
+    {
+        const int S = this->pomdp->GetSizeOfS();
+        s_newI = this->SampleFromCdf(this->trans_cdf->data() + ((size_t)sI * this->pomdp->GetSizeOfA() + aI) * S, S);
+    }
+
+    int oI;
+    const map<int, double> *obs = this->pomdp->GetObsFuncProbDist(s_newI, aI);
+    if (obs)
+    {
+        oI = this->SampleFrom(*obs);
+    }
+    else
+    {
+        const int O = this->pomdp->GetSizeOfObs();
+        oI = this->SampleFromCdf(this->obs_cdf->data() + ((size_t)s_newI * this->pomdp->GetSizeOfA() + aI) * O, O);
+    }
+
+    return make_tuple(s_newI, oI, this->pomdp->Reward(sI, aI), false);
+}
+
+int PomdpSimulator::SampleStartState()
+{
+    const map<int, double> *b0 = this->pomdp->GetInitBeliefSparse();
+    if (b0)
+        return this->SampleFrom(*b0);
+    return uniform_int_distribution<int>(0, this->pomdp->GetSizeOfS() - 1)(this->rng);
+}
+
+int PomdpSimulator::GetSizeOfObs() const
+{
+    return this->pomdp->GetSizeOfObs();
+}
+
+int PomdpSimulator::GetSizeOfA() const
+{
+    return this->pomdp->GetSizeOfA();
+}
+
+double PomdpSimulator::GetDiscount() const
+{
+    return this->pomdp->GetDiscount();
+}
+
+int PomdpSimulator::GetNbAgent() const
+{
+    return 1;
+}
+
+SimInterface *PomdpSimulator::Clone() const
+{
+    return new PomdpSimulator(*this);
+}
+
+void PomdpSimulator::SetSeed(unsigned long seed)
+{
+    this->rng.seed(seed);
+}
+
+bool PomdpSimulator::GetRewardBounds(double &r_min, double &r_max) const
+{
+    r_min = this->r_min;
+    r_max = this->r_max;
+    return true;
+}
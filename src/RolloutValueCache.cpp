@@ -0,0 +1,175 @@
+#include "../include/RolloutValueCache.h"
+
+#include <thread>
+
+RolloutValueCache::RolloutValueCache(size_t capacity)
+{
+    this->capacity = 16;
+    while (this->capacity < capacity)
+        this->capacity *= 2;
+    this->entries.reset(new Entry[this->capacity]);
+}
+
+RolloutValueCache::~RolloutValueCache()
+{
+}
+
+unsigned long long RolloutValueCache::MakeKey(int nI, int sI)
+{
+    return ((unsigned long long)(nI + 1) << 32) | (unsigned)sI;
+}
+
+unsigned RolloutValueCache::GetEpoch(int nI) const
+{
+    return nI < (int)this->node_epoch.size() ? this->node_epoch[nI] : 0;
+}
+
+RolloutValueCache::Entry *RolloutValueCache::FindOrAdd(unsigned long long key)
+{
+    const size_t mask = this->capacity - 1;
+    size_t h = (size_t)(key * 0x9e3779b97f4a7c15ULL >> 17) & mask;
+    // give up after a bounded probe sequence, a full table degrades to no caching
+    for (int probe = 0; probe < 64; probe++)
+    {
+        Entry &e = this->entries[h];
+        unsigned long long k = e.key.load(memory_order_acquire);
+        if (k == key)
+            return &e;
+        if (k == 0)
+        {
+            if (e.key.compare_exchange_strong(k, key, memory_order_acq_rel))
+            {
+                this->nb_entries.fetch_add(1, memory_order_relaxed);
+                return &e;
+            }
+            // another thread claimed the slot, possibly for the same key
+            if (k == key)
+                return &e;
+        }
+        h = (h + 1) & mask;
+    }
+    return nullptr;
+}
+
+RolloutValueCache::Entry *RolloutValueCache::Find(unsigned long long key) const
+{
+    const size_t mask = this->capacity - 1;
+    size_t h = (size_t)(key * 0x9e3779b97f4a7c15ULL >> 17) & mask;
+    // slots are never freed while readers run, so the first free slot ends the sequence
+    for (int probe = 0; probe < 64; probe++)
+    {
+        Entry &e = this->entries[h];
+        unsigned long long k = e.key.load(memory_order_acquire);
+        if (k == key)
+            return &e;
+        if (k == 0)
+            return nullptr;
+        h = (h + 1) & mask;
+    }
+    return nullptr;
+}
+
+void RolloutValueCache::Lock(Entry &e)
+{
+    while (e.locked.exchange(true, memory_order_acquire))
+        this_thread::yield();
+}
+
+void RolloutValueCache::Unlock(Entry &e)
+{
+    e.locked.store(false, memory_order_release);
+}
+
+bool RolloutValueCache::Lookup(int nI, int sI, RunningStat &stat)
+{
+    Entry *e = this->Find(MakeKey(nI, sI));
+    if (!e)
+    {
+        stat.Reset();
+        return false;
+    }
+    const unsigned epoch = this->GetEpoch(nI);
+    this->Lock(*e);
+    if (e->epoch != epoch)
+    {
+        e->epoch = epoch;
+        e->stat.Reset();
+    }
+    stat = e->stat;
+    this->Unlock(*e);
+    return true;
+}
+
+void RolloutValueCache::Add(int nI, int sI, double value)
+{
+    Entry *e = this->FindOrAdd(MakeKey(nI, sI));
+    if (!e)
+        return;
+    const unsigned epoch = this->GetEpoch(nI);
+    this->Lock(*e);
+    if (e->epoch != epoch)
+    {
+        e->epoch = epoch;
+        e->stat.Reset();
+    }
+    e->stat.Add(value);
+    this->Unlock(*e);
+}
+
+void RolloutValueCache::InvalidateNode(int nI)
+{
+    if (nI >= (int)this->node_epoch.size())
+        this->node_epoch.resize(nI + 1, 0);
+    this->node_epoch[nI]++;
+}
+
+void RolloutValueCache::Clear()
+{
+    for (size_t h = 0; h < this->capacity; h++)
+    {
+        this->entries[h].key.store(0, memory_order_relaxed);
+        this->entries[h].epoch = 0;
+        this->entries[h].stat.Reset();
+    }
+    this->node_epoch.clear();
+    this->nb_entries.store(0, memory_order_relaxed);
+}
+
+void RolloutValueCache::Renumber(const vector<int> &new_index)
+{
+    struct Moved
+    {
+        int nI, sI;
+        RunningStat stat;
+    };
+    vector<Moved> moved;
+    for (size_t h = 0; h < this->capacity; h++)
+    {
+        const Entry &e = this->entries[h];
+        unsigned long long k = e.key.load(memory_order_relaxed);
+        if (k == 0 || e.stat.count == 0)
+            continue;
+        int nI = (int)(k >> 32) - 1;
+        if (nI >= (int)new_index.size() || new_index[nI] < 0 || e.epoch != this->GetEpoch(nI))
+            continue;
+        moved.push_back({new_index[nI], (int)(unsigned)(k & 0xffffffffULL), e.stat});
+    }
+
+    this->Clear();
+    for (const Moved &m : moved)
+    {
+        Entry *e = this->FindOrAdd(MakeKey(m.nI, m.sI));
+        if (e && m.stat.count > e->stat.count)
+            e->stat = m.stat;
+    }
+}
+
+size_t RolloutValueCache::GetNbEntries() const
+{
+    return this->nb_entries.load(memory_order_relaxed);
+}
+
+size_t RolloutValueCache::GetCapacity() const
+{
+    return this->capacity;
+}
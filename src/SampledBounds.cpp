@@ -0,0 +1,286 @@
+#include "../include/SampledBounds.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <map>
+#include "../include/SeedMixing.h"
+
+SampledBounds::SampledBounds(SimInterface *sim, int nb_threads, unsigned long seed)
+    : sim(sim), A_size(sim->GetSizeOfA()), discount(sim->GetDiscount()), seed(seed), pool(max(1, nb_threads))
+{
+    this->worker_sims.push_back(sim);
+    for (int w = 1; w < this->pool.GetNbThreads(); w++)
+    {
+        SimInterface *clone = sim->Clone();
+        if (!clone)
+        {
+            cerr << "simulator cannot be cloned, bounds are sampled on one thread" << endl;
+            break;
+        }
+        this->owned_sims.emplace_back(clone);
+        this->worker_sims.push_back(clone);
+    }
+    this->has_reward_bounds = sim->GetRewardBounds(this->r_min, this->r_max);
+    if (!this->has_reward_bounds)
+    {
+        this->r_min = numeric_limits<double>::infinity();
+        this->r_max = -numeric_limits<double>::infinity();
+    }
+    this->row_start.assign(1, 0);
+}
+
+SampledBounds::~SampledBounds()
+{
+}
+
+int SampledBounds::AddState(int sI)
+{
+    auto it = this->state_index.find(sI);
+    if (it != this->state_index.end())
+        return it->second;
+    int i = this->states.size();
+    this->states.push_back(sI);
+    this->state_index[sI] = i;
+    return i;
+}
+
+double SampledBounds::GetOptimisticValue() const
+{
+    // undiscounted problems use 0, as PomdpBounds does
+    if (this->discount >= 1.0 || this->r_max < this->r_min)
+        return 0.0;
+    return this->r_max / (1.0 - this->discount);
+}
+
+double SampledBounds::GetPessimisticValue() const
+{
+    if (this->discount >= 1.0 || this->r_max < this->r_min)
+        return 0.0;
+    return this->r_min / (1.0 - this->discount);
+}
+
+int SampledBounds::Explore(const vector<int> &start_states, int nb_samples, int max_states)
+{
+    struct Outcome
+    {
+        int s_newI;
+        double r;
+        bool done;
+    };
+    const int A = this->A_size;
+    nb_samples = max(1, nb_samples);
+    for (int sI : start_states)
+        this->AddState(sI);
+
+    // one breadth first level per round
+    while (this->nb_expanded < (int)this->states.size() && this->nb_expanded < max_states)
+    {
+        const int i_begin = this->nb_expanded;
+        const int i_end = min((int)this->states.size(), max_states);
+        const int nb = i_end - i_begin;
+        vector<Outcome> outcomes((size_t)nb * A * nb_samples);
+        const int nb_tasks = max(1, min((int)this->worker_sims.size(), nb));
+        this->pool.ParallelFor(nb_tasks, [&](int task, int worker)
+                               {
+            SimInterface *sim = this->worker_sims[worker];
+            const int k_begin = (long long)nb * task / nb_tasks;
+            const int k_end = (long long)nb * (task + 1) / nb_tasks;
+            for (int k = k_begin; k < k_end; k++)
+            {
+                // seeded by the state, so the model does not depend on the thread count
+                const int sI = this->states[i_begin + k];
+                sim->SetSeed(MixSeed(this->seed ^ MixSeed((unsigned long)sI)));
+                Outcome *out = &outcomes[(size_t)k * A * nb_samples];
+                for (int aI = 0; aI < A; aI++)
+                {
+                    for (int j = 0; j < nb_samples; j++)
+                    {
+                        Outcome &o = out[(size_t)aI * nb_samples + j];
+                        int oI;
+                        tie(o.s_newI, oI, o.r, o.done) = sim->Step(sI, aI);
+                    }
+                }
+            } });
+
+        // merge in index order, so new states get the same indices for any thread count
+        for (int k = 0; k < nb; k++)
+        {
+            for (int aI = 0; aI < A; aI++)
+            {
+                const Outcome *out = &outcomes[((size_t)k * A + aI) * nb_samples];
+                map<int, int> counts;
+                double r_sum = 0.0;
+                for (int j = 0; j < nb_samples; j++)
+                {
+                    r_sum += out[j].r;
+                    if (!this->has_reward_bounds)
+                    {
+                        this->r_min = min(this->r_min, out[j].r);
+                        this->r_max = max(this->r_max, out[j].r);
+                    }
+                    counts[out[j].done ? -1 : this->AddState(out[j].s_newI)]++;
+                }
+                for (const auto &it : counts)
+                {
+                    this->succ_index.push_back(it.first);
+                    this->succ_prob.push_back((double)it.second / nb_samples);
+                }
+                this->row_start.push_back(this->succ_index.size());
+                this->rewards.push_back(r_sum / nb_samples);
+            }
+        }
+        this->nb_expanded = i_end;
+    }
+
+    // values computed so far are kept, new entries start from the bounds
+    this->V_upper.resize(this->states.size(), this->GetOptimisticValue());
+    this->Q_upper.resize((size_t)this->nb_expanded * A, this->GetOptimisticValue());
+    this->W_lower.resize((size_t)this->nb_expanded * A, this->GetPessimisticValue());
+    return this->nb_expanded;
+}
+
+double SampledBounds::Sweep(int i_begin, int i_end, const vector<double> &V_prev, const vector<double> &W_prev)
+{
+    const int A = this->A_size;
+    const double pessimistic = this->GetPessimisticValue();
+    double residual = 0.0;
+    for (int i = i_begin; i < i_end; i++)
+    {
+        double v = -numeric_limits<double>::infinity();
+        for (int aI = 0; aI < A; aI++)
+        {
+            const size_t row = (size_t)i * A + aI;
+            double future_V = 0.0, future_W = 0.0;
+            for (int t = this->row_start[row]; t < this->row_start[row + 1]; t++)
+            {
+                const int next = this->succ_index[t];
+                // terminal transitions have no future, unexpanded states keep their initial values
+                if (next < 0)
+                    continue;
+                future_V += this->succ_prob[t] * V_prev[next];
+                future_W += this->succ_prob[t] *
+                            (next < this->nb_expanded ? W_prev[(size_t)next * A + aI] : pessimistic);
+            }
+            this->Q_upper[row] = this->rewards[row] + this->discount * future_V;
+            v = max(v, this->Q_upper[row]);
+            double w = this->rewards[row] + this->discount * future_W;
+            residual = max(residual, fabs(w - this->W_lower[row]));
+            this->W_lower[row] = w;
+        }
+        residual = max(residual, fabs(v - this->V_upper[i]));
+        this->V_upper[i] = v;
+    }
+    return residual;
+}
+
+int SampledBounds::Compute(double tolerance, int max_iterations)
+{
+    const int nb = this->nb_expanded;
+    const int nb_blocks = max(1, min(this->pool.GetNbThreads(), nb));
+    vector<double> V_prev, W_prev;
+    vector<double> block_residual(nb_blocks);
+    int iter = 0;
+    double residual = 0.0;
+    for (iter = 1; iter <= max_iterations; iter++)
+    {
+        V_prev = this->V_upper;
+        W_prev = this->W_lower;
+        this->pool.ParallelFor(nb_blocks, [&](int b, int)
+                               {
+            int i_begin = (long long)nb * b / nb_blocks;
+            int i_end = (long long)nb * (b + 1) / nb_blocks;
+            block_residual[b] = this->Sweep(i_begin, i_end, V_prev, W_prev); });
+        residual = *max_element(block_residual.begin(), block_residual.end());
+        if (residual < tolerance)
+            break;
+    }
+
+    this->last_iterations = min(iter, max_iterations);
+    this->last_residual = residual;
+    return this->last_iterations;
+}
+
+int SampledBounds::GetNbStates() const
+{
+    return this->states.size();
+}
+
+int SampledBounds::GetNbExpanded() const
+{
+    return this->nb_expanded;
+}
+
+int SampledBounds::GetLastIterations() const
+{
+    return this->last_iterations;
+}
+
+double SampledBounds::GetLastResidual() const
+{
+    return this->last_residual;
+}
+
+double SampledBounds::GetUpperBound(int sI) const
+{
+    auto it = this->state_index.find(sI);
+    if (it == this->state_index.end())
+        return this->GetOptimisticValue();
+    return this->V_upper[it->second];
+}
+
+double SampledBounds::GetLowerBound(int sI) const
+{
+    auto it = this->state_index.find(sI);
+    if (it == this->state_index.end() || it->second >= this->nb_expanded)
+        return this->GetPessimisticValue();
+    double best = -numeric_limits<double>::infinity();
+    for (int aI = 0; aI < this->A_size; aI++)
+        best = max(best, this->W_lower[(size_t)it->second * this->A_size + aI]);
+    return best;
+}
+
+double SampledBounds::GetUpperBound(const vector<int> &particles) const
+{
+    if (particles.empty())
+        return 0.0;
+    const int A = this->A_size;
+    // QMDP over the expanded particles, the others count with the optimistic value
+    vector<double> sum(A, 0.0);
+    for (int sI : particles)
+    {
+        auto it = this->state_index.find(sI);
+        if (it == this->state_index.end() || it->second >= this->nb_expanded)
+        {
+            for (int aI = 0; aI < A; aI++)
+                sum[aI] += this->GetOptimisticValue();
+            continue;
+        }
+        const double *Q_i = &this->Q_upper[(size_t)it->second * A];
+        for (int aI = 0; aI < A; aI++)
+            sum[aI] += Q_i[aI];
+    }
+    return *max_element(sum.begin(), sum.end()) / particles.size();
+}
+
+double SampledBounds::GetLowerBound(const vector<int> &particles) const
+{
+    if (particles.empty())
+        return 0.0;
+    const int A = this->A_size;
+    vector<double> sum(A, 0.0);
+    for (int sI : particles)
+    {
+        auto it = this->state_index.find(sI);
+        if (it == this->state_index.end() || it->second >= this->nb_expanded)
+        {
+            for (int aI = 0; aI < A; aI++)
+                sum[aI] += this->GetPessimisticValue();
+            continue;
+        }
+        const double *W_i = &this->W_lower[(size_t)it->second * A];
+        for (int aI = 0; aI < A; aI++)
+            sum[aI] += W_i[aI];
+    }
+    return *max_element(sum.begin(), sum.end()) / particles.size();
+}
@@ -0,0 +1,86 @@
+#include "../include/ThreadPool.h"
+
+ThreadPool::ThreadPool(int nb_threads)
+{
+    for (int w = 1; w < nb_threads; w++)
+        this->workers.emplace_back(&ThreadPool::WorkerLoop, this, w);
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        lock_guard<mutex> lock(this->m);
+        this->stop = true;
+    }
+    this->cv_work.notify_all();
+    for (auto &w : this->workers)
+        w.join();
+}
+
+int ThreadPool::GetNbThreads() const
+{
+    return this->workers.size() + 1;
+}
+
+void ThreadPool::RunTasks(const function<void(int, int)> *fn, int count, int worker)
+{
+    int task;
+    while ((task = this->next_task.fetch_add(1)) < count)
+        (*fn)(task, worker);
+}
+
+void ThreadPool::WorkerLoop(int worker)
+{
+    unsigned long seen = 0;
+    while (true)
+    {
+        const function<void(int, int)> *fn;
+        int count;
+        {
+            unique_lock<mutex> lock(this->m);
+            this->cv_work.wait(lock, [&]
+                               { return this->stop || this->generation != seen; });
+            if (this->stop)
+                return;
+            seen = this->generation;
+            fn = this->job;
+            count = this->nb_tasks;
+            this->nb_busy++;
+        }
+        this->RunTasks(fn, count, worker);
+        {
+            lock_guard<mutex> lock(this->m);
+            if (--this->nb_busy == 0)
+                this->cv_done.notify_all();
+        }
+    }
+}
+
+void ThreadPool::ParallelFor(int nb_tasks, const function<void(int task, int worker)> &fn)
+{
+    if (this->workers.empty() || nb_tasks <= 1)
+    {
+        for (int task = 0; task < nb_tasks; task++)
+            fn(task, 0);
+        return;
+    }
+
+    {
+        // a worker that woke up late for the previous batch must leave it first
+        unique_lock<mutex> lock(this->m);
+        this->cv_done.wait(lock, [&]
+                           { return this->nb_busy == 0; });
+        this->job = &fn;
+        this->nb_tasks = nb_tasks;
+        this->next_task.store(0);
+        this->generation++;
+    }
+    this->cv_work.notify_all();
+    this->RunTasks(&fn, nb_tasks, 0);
+
+    // workers that wake up late find no task left and leave immediately
+    unique_lock<mutex> lock(this->m);
+    this->cv_done.wait(lock, [&]
+                       { return this->nb_busy == 0 && this->next_task.load() >= this->nb_tasks; });
+    this->job = nullptr;
+}
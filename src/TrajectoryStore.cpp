@@ -0,0 +1,152 @@
+#include "../include/TrajectoryStore.h"
+
+TrajectoryStore::TrajectoryStore(int max_beliefs, size_t max_bytes)
+    : max_beliefs(max_beliefs < 1 ? 1 : max_beliefs), max_bytes(max_bytes)
+{
+}
+
+TrajectoryStore::~TrajectoryStore()
+{
+}
+
+/* FNV-1a over the particles */
+unsigned long long TrajectoryStore::HashBelief(const vector<int> &belief)
+{
+    unsigned long long h = 0xcbf29ce484222325ULL;
+    for (int sI : belief)
+    {
+        h ^= (unsigned)sI;
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+size_t TrajectoryStore::GetNbBytes(const BeliefSamples &b)
+{
+    size_t nb_bytes = sizeof(BeliefSamples) + b.samples.capacity() * sizeof(StoredSample);
+    for (const StoredSample &sample : b.samples)
+    {
+        nb_bytes += sample.trajectories.capacity() * sizeof(StoredTrajectory);
+        for (const StoredTrajectory &traj : sample.trajectories)
+            nb_bytes += traj.steps.capacity() * sizeof(StoredStep);
+    }
+    return nb_bytes;
+}
+
+void TrajectoryStore::EvictOldest()
+{
+    size_t oldest = 0;
+    for (size_t k = 1; k < this->beliefs.size(); k++)
+        if (this->beliefs[k]->last_use < this->beliefs[oldest]->last_use)
+            oldest = k;
+    this->beliefs.erase(this->beliefs.begin() + oldest);
+}
+
+StoredSample *TrajectoryStore::GetSamples(unsigned long long key, int A, int K)
+{
+    this->clock++;
+    for (auto &b : this->beliefs)
+    {
+        if (b->key != key)
+            continue;
+        b->last_use = this->clock;
+        if (b->A != A || b->K != K)
+        {
+            b->A = A;
+            b->K = K;
+            b->samples.assign((size_t)A * K, StoredSample());
+        }
+        return b->samples.data();
+    }
+
+    if ((int)this->beliefs.size() >= this->max_beliefs)
+        this->EvictOldest();
+    unique_ptr<BeliefSamples> b(new BeliefSamples());
+    b->key = key;
+    b->last_use = this->clock;
+    b->A = A;
+    b->K = K;
+    b->samples.assign((size_t)A * K, StoredSample());
+    this->beliefs.push_back(move(b));
+    return this->beliefs.back()->samples.data();
+}
+
+void TrajectoryStore::Renumber(const vector<int> &new_index)
+{
+    int nb_new = 0;
+    for (int nI : new_index)
+        nb_new = nI + 1 > nb_new ? nI + 1 : nb_new;
+    for (auto &b : this->beliefs)
+    {
+        for (StoredSample &sample : b->samples)
+        {
+            if (!sample.valid)
+                continue;
+            vector<StoredTrajectory> renumbered(nb_new);
+            for (size_t k = 0; k < sample.trajectories.size() && k < new_index.size(); k++)
+            {
+                int nI = new_index[k];
+                if (nI < 0 || !renumbered[nI].steps.empty())
+                    continue;
+                renumbered[nI] = move(sample.trajectories[k]);
+            }
+            // steps through dropped nodes are cut off, replay resumes from there
+            for (StoredTrajectory &traj : renumbered)
+            {
+                for (size_t t = 0; t < traj.steps.size(); t++)
+                {
+                    int nI = traj.steps[t].nI;
+                    if (nI < 0 || nI >= (int)new_index.size() || new_index[nI] < 0)
+                    {
+                        traj.steps.resize(t);
+                        traj.done = false;
+                        break;
+                    }
+                    traj.steps[t].nI = new_index[nI];
+                }
+            }
+            sample.trajectories.swap(renumbered);
+        }
+    }
+}
+
+void TrajectoryStore::Trim()
+{
+    if (this->max_bytes == 0)
+        return;
+    vector<size_t> nb_bytes(this->beliefs.size());
+    size_t total = 0;
+    for (size_t k = 0; k < this->beliefs.size(); k++)
+    {
+        nb_bytes[k] = GetNbBytes(*this->beliefs[k]);
+        total += nb_bytes[k];
+    }
+    while (total > this->max_bytes && !this->beliefs.empty())
+    {
+        size_t oldest = 0;
+        for (size_t k = 1; k < this->beliefs.size(); k++)
+            if (this->beliefs[k]->last_use < this->beliefs[oldest]->last_use)
+                oldest = k;
+        total -= nb_bytes[oldest];
+        nb_bytes.erase(nb_bytes.begin() + oldest);
+        this->beliefs.erase(this->beliefs.begin() + oldest);
+    }
+}
+
+void TrajectoryStore::Clear()
+{
+    this->beliefs.clear();
+}
+
+int TrajectoryStore::GetNbBeliefs() const
+{
+    return this->beliefs.size();
+}
+
+size_t TrajectoryStore::GetNbBytes() const
+{
+    size_t total = 0;
+    for (const auto &b : this->beliefs)
+        total += GetNbBytes(*b);
+    return total;
+}
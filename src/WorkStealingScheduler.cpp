@@ -0,0 +1,255 @@
+#include "../include/WorkStealingScheduler.h"
+
+#include <algorithm>
+#include <chrono>
+
+/* scheduler and worker index of the current thread, if it is a worker thread */
+static thread_local const WorkStealingScheduler *current_scheduler = nullptr;
+static thread_local int current_worker = 0;
+
+TaskGroup::TaskGroup(WorkStealingScheduler &scheduler) : scheduler(scheduler)
+{
+}
+
+TaskGroup::~TaskGroup()
+{
+    this->Join();
+}
+
+void TaskGroup::Fork(function<void(int worker)> fn)
+{
+    this->pending++;
+    this->scheduler.Push(this->scheduler.GetCurrentWorker(), new WorkStealingScheduler::Task{move(fn), this});
+    this->scheduler.Notify();
+}
+
+void TaskGroup::Join()
+{
+    this->scheduler.Join(*this);
+}
+
+WorkStealingScheduler::WorkStealingScheduler(int nb_threads)
+{
+    nb_threads = max(1, nb_threads);
+    for (int w = 0; w < nb_threads; w++)
+        this->queues.emplace_back(new WorkerQueue());
+    for (int w = 1; w < nb_threads; w++)
+        this->workers.emplace_back(&WorkStealingScheduler::WorkerLoop, this, w);
+}
+
+WorkStealingScheduler::~WorkStealingScheduler()
+{
+    {
+        lock_guard<mutex> lock(this->m);
+        this->stop = true;
+    }
+    this->cv.notify_all();
+    for (auto &w : this->workers)
+        w.join();
+}
+
+int WorkStealingScheduler::GetNbThreads() const
+{
+    return this->queues.size();
+}
+
+void WorkStealingScheduler::SetStealing(bool stealing)
+{
+    this->stealing.store(stealing);
+}
+
+bool WorkStealingScheduler::GetStealing() const
+{
+    return this->stealing.load();
+}
+
+int WorkStealingScheduler::GetCurrentWorker() const
+{
+    // threads outside the scheduler act as worker 0
+    return current_scheduler == this ? current_worker : 0;
+}
+
+void WorkStealingScheduler::Push(int worker, Task *task)
+{
+    WorkerQueue &q = *this->queues[worker];
+    lock_guard<mutex> lock(q.m);
+    q.tasks.push_back(task);
+    q.size++;
+    this->nb_queued++;
+}
+
+void WorkStealingScheduler::Notify()
+{
+    // taking the lock orders the notification after the waiters' checks
+    {
+        lock_guard<mutex> lock(this->m);
+    }
+    this->cv.notify_all();
+}
+
+WorkStealingScheduler::Task *WorkStealingScheduler::TakeTask(int worker)
+{
+    const int W = this->queues.size();
+    // newest task of the own deque
+    {
+        WorkerQueue &q = *this->queues[worker];
+        lock_guard<mutex> lock(q.m);
+        if (!q.tasks.empty())
+        {
+            Task *task = q.tasks.back();
+            q.tasks.pop_back();
+            q.size--;
+            this->nb_queued--;
+            return task;
+        }
+    }
+    if (!this->stealing.load())
+        return nullptr;
+    // oldest task of the next non-empty deque
+    for (int k = 1; k < W; k++)
+    {
+        WorkerQueue &victim = *this->queues[(worker + k) % W];
+        if (victim.size.load() == 0)
+            continue;
+        lock_guard<mutex> lock(victim.m);
+        if (victim.tasks.empty())
+            continue;
+        Task *task = victim.tasks.front();
+        victim.tasks.pop_front();
+        victim.size--;
+        this->nb_queued--;
+        this->queues[worker]->nb_steals++;
+        return task;
+    }
+    return nullptr;
+}
+
+void WorkStealingScheduler::Execute(Task *task, int worker)
+{
+    task->fn(worker);
+    this->queues[worker]->nb_tasks++;
+    TaskGroup *group = task->group;
+    delete task;
+    if (--group->pending == 0)
+        this->Notify();
+}
+
+bool WorkStealingScheduler::HasWork(int worker) const
+{
+    return this->stealing.load() ? this->nb_queued.load() > 0 : this->queues[worker]->size.load() > 0;
+}
+
+void WorkStealingScheduler::Join(TaskGroup &group)
+{
+    const int worker = this->GetCurrentWorker();
+    while (group.pending.load() > 0)
+    {
+        Task *task = this->TakeTask(worker);
+        if (task)
+        {
+            this->Execute(task, worker);
+            continue;
+        }
+        unique_lock<mutex> lock(this->m);
+        this->cv.wait(lock, [&]
+                      { return group.pending.load() == 0 || this->HasWork(worker); });
+    }
+}
+
+void WorkStealingScheduler::WorkerLoop(int worker)
+{
+    current_scheduler = this;
+    current_worker = worker;
+    while (true)
+    {
+        Task *task = this->TakeTask(worker);
+        if (task)
+        {
+            this->Execute(task, worker);
+            continue;
+        }
+        unique_lock<mutex> lock(this->m);
+        this->cv.wait(lock, [&]
+                      { return this->stop || this->HasWork(worker); });
+        if (this->stop)
+            return;
+    }
+}
+
+void WorkStealingScheduler::ParallelFor(int nb_tasks, const function<void(int task, int worker)> &fn)
+{
+    const int W = this->queues.size();
+    const int caller = this->GetCurrentWorker();
+    if (W == 1 || nb_tasks <= 1)
+    {
+        for (int task = 0; task < nb_tasks; task++)
+            fn(task, caller);
+        this->queues[caller]->nb_tasks += max(0, nb_tasks);
+        return;
+    }
+
+    // busy time of each worker in this call; a worker only writes its own slot
+    vector<double> busy(W, 0.0);
+    {
+        TaskGroup group(*this);
+        group.pending += nb_tasks;
+        for (int k = 0; k < W; k++)
+        {
+            // block k goes to worker caller + k, pushed last first so the owner runs it in order
+            const int worker = (caller + k) % W;
+            const int t_begin = (long long)nb_tasks * k / W;
+            const int t_end = (long long)nb_tasks * (k + 1) / W;
+            for (int task = t_end - 1; task >= t_begin; task--)
+            {
+                this->Push(worker, new Task{[&fn, &busy, task](int w)
+                                            {
+                                                auto start = chrono::steady_clock::now();
+                                                fn(task, w);
+                                                busy[w] += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+                                            },
+                                            &group});
+            }
+        }
+        this->Notify();
+        group.Join();
+    }
+
+    double b_max = 0.0, b_sum = 0.0;
+    for (double b : busy)
+    {
+        b_max = max(b_max, b);
+        b_sum += b;
+    }
+    lock_guard<mutex> lock(this->stats_mutex);
+    this->nb_parallel_fors++;
+    this->busy_max += b_max;
+    this->busy_mean += b_sum / W;
+}
+
+SchedulerStats WorkStealingScheduler::GetStats() const
+{
+    SchedulerStats stats;
+    for (const auto &q : this->queues)
+    {
+        stats.nb_tasks += q->nb_tasks.load();
+        stats.nb_steals += q->nb_steals.load();
+    }
+    lock_guard<mutex> lock(this->stats_mutex);
+    stats.nb_parallel_fors = this->nb_parallel_fors;
+    stats.busy_max = this->busy_max;
+    stats.busy_mean = this->busy_mean;
+    return stats;
+}
+
+void WorkStealingScheduler::ResetStats()
+{
+    for (auto &q : this->queues)
+    {
+        q->nb_tasks.store(0);
+        q->nb_steals.store(0);
+    }
+    lock_guard<mutex> lock(this->stats_mutex);
+    this->nb_parallel_fors = 0;
+    this->busy_max = 0.0;
+    this->busy_mean = 0.0;
+}
@@ -0,0 +1,176 @@
+/* This file has been written and/or modified by the following people:
+ *
+ * Yang You
+ * Alex Schutz
+ *
+ */
+
+// Checks that the header written by ExportFSCToCppHeader executes the same controller as
+// the interpreted one: a random controller with missing edges is exported, compiled into a
+// small driver and both are stepped over the same random observation sequences.
+//   g++ -std=c++17 -O2 -Iinclude test/TestFscCodeGen.cpp src/FscCodeGen.cpp src/AlphaVectorFSC.cpp -o test_fsc_codegen
+//   ./test_fsc_codegen [nodes=300] [A=4] [O=5] [sequences=200] [length=50]
+// The driver is built with $CXX (c++ if unset). Exits with 0 if every action matches.
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+#include <vector>
+#include "../include/AlphaVectorFSC.h"
+#include "../include/FscCodeGen.h"
+#include "../include/FscRuntime.h"
+
+using namespace std;
+
+// reads "nb_sequences length" then the observations, prints one action per step
+static const char *DRIVER_SOURCE =
+    "#include <cstdio>\n"
+    "#include \"policy.h\"\n"
+    "int main(int argc, char **argv)\n"
+    "{\n"
+    "    FILE *f = fopen(argv[1], \"r\");\n"
+    "    int nb_sequences, length;\n"
+    "    if (!f || fscanf(f, \"%d %d\", &nb_sequences, &length) != 2)\n"
+    "        return 1;\n"
+    "    for (int s = 0; s < nb_sequences; s++)\n"
+    "    {\n"
+    "        int nI = 0;\n"
+    "        for (int t = 0; t < length; t++)\n"
+    "        {\n"
+    "            int oI;\n"
+    "            if (fscanf(f, \"%d\", &oI) != 1)\n"
+    "                return 1;\n"
+    "            printf(\"%d\\n\", test_policy::GetAction(nI));\n"
+    "            nI = test_policy::Step(nI, oI);\n"
+    "        }\n"
+    "    }\n"
+    "    return 0;\n"
+    "}\n";
+
+static bool CheckIdentifiers()
+{
+    const char *valid[] = {"mcvi_policy", "_p", "P2", "robot_controller_v3"};
+    const char *invalid[] = {"", "2p", "a-b", "a::b", "my policy", "namespace", "int", "a;b"};
+    bool ok = true;
+    for (const char *name : valid)
+        if (!IsValidCppIdentifier(name))
+        {
+            fprintf(stderr, "rejected valid name '%s'\n", name);
+            ok = false;
+        }
+    for (const char *name : invalid)
+        if (IsValidCppIdentifier(name))
+        {
+            fprintf(stderr, "accepted invalid name '%s'\n", name);
+            ok = false;
+        }
+    // nothing is written under an invalid name
+    AlphaVectorFSC fsc(2, 2);
+    ostringstream os;
+    if (ExportFSCToCppHeader(fsc, os, "bad name") || !os.str().empty())
+    {
+        fprintf(stderr, "export under an invalid name did not fail cleanly\n");
+        ok = false;
+    }
+    return ok;
+}
+
+int main(int argc, char **argv)
+{
+    const int N = argc > 1 ? atoi(argv[1]) : 300;
+    const int A = argc > 2 ? atoi(argv[2]) : 4;
+    const int O = argc > 3 ? atoi(argv[3]) : 5;
+    const int nb_sequences = argc > 4 ? atoi(argv[4]) : 200;
+    const int length = argc > 5 ? atoi(argv[5]) : 50;
+
+    if (!CheckIdentifiers())
+        return 1;
+
+    // random controller, a fifth of the edges left unset
+    mt19937_64 rng(1);
+    AlphaVectorFSC fsc(A, O);
+    for (int nI = 0; nI < N; nI++)
+    {
+        FscNode node;
+        node.best_action = rng() % A;
+        fsc.AddNode(node);
+    }
+    for (int nI = 0; nI < N; nI++)
+        for (int aI = 0; aI < A; aI++)
+            for (int oI = 0; oI < O; oI++)
+                if (rng() % 5 != 0)
+                    fsc.UpdateEta(nI, aI, oI, rng() % N);
+
+    char dir_template[] = "/tmp/test_fsc_codegen_XXXXXX";
+    if (!mkdtemp(dir_template))
+    {
+        perror("mkdtemp");
+        return 1;
+    }
+    const string dir = dir_template;
+    if (!ExportFSCToCppHeader(fsc, dir + "/policy.h", "test_policy"))
+        return 1;
+    ofstream(dir + "/driver.cpp") << DRIVER_SOURCE;
+
+    vector<int> obs((size_t)nb_sequences * length);
+    {
+        ofstream obs_file(dir + "/obs.txt");
+        obs_file << nb_sequences << " " << length << "\n";
+        for (size_t k = 0; k < obs.size(); k++)
+        {
+            obs[k] = rng() % O;
+            obs_file << obs[k] << (k % length == (size_t)length - 1 ? "\n" : " ");
+        }
+    }
+
+    const char *cxx = getenv("CXX");
+    const string compile = string(cxx ? cxx : "c++") + " -std=c++11 -O1 -Wall -Werror " + dir + "/driver.cpp -o " +
+                           dir + "/driver";
+    if (system(compile.c_str()) != 0)
+    {
+        fprintf(stderr, "generated header does not compile: %s\n", compile.c_str());
+        return 1;
+    }
+    const string run = dir + "/driver " + dir + "/obs.txt";
+    FILE *pipe = popen(run.c_str(), "r");
+    if (!pipe)
+    {
+        perror("popen");
+        return 1;
+    }
+
+    // the interpreted controller, missing edges keep the current node as in the planner
+    FscPolicyTable table(fsc);
+    const FscPolicyView policy = table.GetView(FscEdgeFallback::Stay);
+    long nb_steps = 0, nb_mismatches = 0;
+    for (int s = 0; s < nb_sequences; s++)
+    {
+        int nI = 0;
+        for (int t = 0; t < length; t++)
+        {
+            int generated_action;
+            if (fscanf(pipe, "%d", &generated_action) != 1)
+            {
+                fprintf(stderr, "driver output ended after %ld steps\n", nb_steps);
+                pclose(pipe);
+                return 1;
+            }
+            if (generated_action != policy.GetAction(nI))
+                nb_mismatches++;
+            nI = policy.Step(nI, obs[(size_t)s * length + t]);
+            nb_steps++;
+        }
+    }
+    const int status = pclose(pipe);
+
+    for (const char *file : {"policy.h", "driver.cpp", "driver", "obs.txt"})
+        unlink((dir + "/" + file).c_str());
+    rmdir(dir.c_str());
+
+    printf("%ld steps, %ld mismatches\n", nb_steps, nb_mismatches);
+    return status == 0 && nb_mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,52 @@
+/* This file has been written and/or modified by the following people:
+ *
+ * Yang You
+ * Alex Schutz
+ *
+ */
+
+// Worker process of a distributed planner on a .pomdp model.
+//   g++ -std=c++17 -O2 -pthread -Iinclude tools/MCVIWorkerMain.cpp src/*.cpp -o mcvi_worker
+//   ./mcvi_worker <model.pomdp> <address> [nb_sample=100] [L=50] [seed=0] [crn=0] [batched=1] [threads=1]
+// The address is "unix:<path>" or "tcp:<host>:<port>", the one given to
+// DistributedEvaluator::AddWorker. nb_sample, L, seed, crn and batched must match the
+// coordinator's planner, which refuses the worker otherwise. The worker serves one
+// coordinator and exits with 0 once it is shut down, 1 on an error.
+
+#include <cstdlib>
+#include <iostream>
+#include "../include/MCVIWorker.h"
+#include "../include/ParserPOMDPSparse.h"
+#include "../include/PomdpSimulator.h"
+
+using namespace std;
+
+int main(int argc, char **argv)
+{
+    if (argc < 3)
+    {
+        cerr << "usage: " << argv[0]
+             << " <model.pomdp> <address> [nb_sample] [L] [seed] [crn] [batched] [threads]" << endl;
+        return 1;
+    }
+    MCVIParameters params;
+    if (argc > 3)
+        params.nb_sample = atoi(argv[3]);
+    if (argc > 4)
+        params.L = atoi(argv[4]);
+    if (argc > 5)
+        params.seed = strtoul(argv[5], nullptr, 10);
+    if (argc > 6)
+        params.common_random_numbers = atoi(argv[6]) != 0;
+    if (argc > 7)
+        params.batched_rollouts = atoi(argv[7]) != 0;
+    if (argc > 8)
+        params.nb_threads = atoi(argv[8]);
+
+    ParsedPOMDPSparse pomdp(argv[1]);
+    PomdpSimulator sim(&pomdp, params.seed);
+    MCVIWorker worker(&sim, params);
+    bool ok = worker.Serve(argv[2]);
+    cerr << "worker " << argv[2] << ": " << worker.GetNbJobs() << " jobs" << endl;
+    return ok ? 0 : 1;
+}